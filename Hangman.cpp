@@ -2,73 +2,1197 @@
 #include <vector> // dynamic array that can change size as needed. 
 #include <string>
 #include <cstdlib> // random number generation 
-#include <ctime> // for working with time and date,
 #include <cctype> // for manipulation of characters
-#include <unordered_set> // For storing unique items in an unordered collection, making lookups faster.
+#include <stdexcept> // For reporting dictionary errors
+#include <algorithm> // For sorting revealed patterns
+#include <cmath> // For log2 in the information-gain strategy
+#include <cstdint> // For the 64-bit words of candidate bitsets
+#include <chrono> // For timing solver decisions
+#include <cstring> // For memchr when splitting the dictionary into lines
+#include <cerrno> // For errno set by system calls
+#include <string_view> // For words viewed in place in the dictionary file
+#include <random> // For random_device when seeding the word generator
+#include <fcntl.h> // For opening the dictionary file
+#include <unistd.h> // For close
+#include <sys/stat.h> // For the size of the dictionary file
+#include <sys/mman.h> // For memory-mapping the dictionary file
+#include <memory> // For the dictionary chosen at startup and the simulation's guessers
+#include <thread> // For simulating games on every core
+#include <csignal> // For stopping the server cleanly
+#ifdef __linux__
+#include <sys/epoll.h> // For the game server's event loop
+#include <sys/socket.h> // For the server and load-generator sockets
+#include <sys/un.h> // For Unix-domain socket addresses
+#include <sys/resource.h> // For raising the open-descriptor limit
+#include <netinet/in.h> // For loopback TCP addresses
+#include <netinet/tcp.h> // For TCP_NODELAY
+#include <arpa/inet.h> // For inet_pton
+#endif
 
 using namespace std;
 
+// The words played when no dictionary file is given
+const char* const builtInWords = "teacher\nprogramming\nhangman\ndifficulty\nkeyboard\ndeveloper\nalgorithm\n";
+
+// FastRandom Class: Small, fast generator (xoshiro256**) seeded once per
+// process. below(n) draws without the bias of rand() % n.
+class FastRandom {
+private:
+    uint64_t state[4];
+
+    static uint64_t rotate(uint64_t x, int bits) { return (x << bits) | (x >> (64 - bits)); }
+
+public:
+    explicit FastRandom(uint64_t seed) {
+        for (uint64_t& word : state) {
+            // SplitMix64 spreads the seed over the whole state
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotate(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotate(state[3], 45);
+        return result;
+    }
+
+    // Function to draw uniformly from 0 .. n-1 (Lemire's multiply-and-reject)
+    uint64_t below(uint64_t n) {
+        unsigned __int128 product = static_cast<unsigned __int128>(next()) * n;
+        if (static_cast<uint64_t>(product) < n) {
+            uint64_t threshold = -n % n;
+            while (static_cast<uint64_t>(product) < threshold) product = static_cast<unsigned __int128>(next()) * n;
+        }
+        return static_cast<uint64_t>(product >> 64);
+    }
+};
+
+// Function to get the process's generator, seeded on first use
+FastRandom& processRandom() {
+    static FastRandom generator(random_device{}() ^
+                                static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count()));
+    return generator;
+}
+
+// Enum for how hard a word is to guess, judged by its uncommon letters
+enum class Difficulty { easy, medium, hard };
+const size_t difficultyCount = 3; // Number of Difficulty values
+const int anyDifficulty = -1;     // Filter value for "any difficulty"
+
+// Dictionary Class: Words read straight from a memory-mapped file (one per
+// line), without allocating a string per word. Words are sorted by length
+// and then difficulty, so every length/difficulty filter is a contiguous
+// range found in a fixed-size table, and picking a random word is O(1).
+// Each word also has a 26-bit mask of the letters it contains.
+class Dictionary {
+public:
+    static constexpr size_t maxWordLength = 32; // Longer words are skipped
+
+private:
+    char* text = nullptr;        // The mapped file (private copy-on-write, so words can be lowercased in place)
+    size_t textSize = 0;
+    string builtInText;          // Backing text when not loaded from a file
+    vector<uint32_t> offsets;    // Start of each word in text, sorted by (length, difficulty)
+    vector<uint32_t> masks;      // Letters in each word, in the same order
+    // First word index of each (length, difficulty); start[length][difficultyCount] == start[length + 1][0]
+    size_t start[maxWordLength + 2][difficultyCount + 1] = {};
+
+public:
+    // Function to map and index a dictionary file (the built-in words if path is empty)
+    explicit Dictionary(const string& path) {
+        if (path.empty()) {
+            builtInText = builtInWords;
+            text = builtInText.data();
+            textSize = builtInText.size();
+            build();
+            return;
+        }
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw runtime_error("Cannot open dictionary " + path + ": " + strerror(errno));
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw runtime_error("Cannot read dictionary " + path + ": " + strerror(errno));
+        }
+        textSize = static_cast<size_t>(info.st_size);
+        if (textSize > UINT32_MAX) {
+            close(fd);
+            throw runtime_error("Dictionary " + path + " is larger than 4 GB");
+        }
+        if (textSize > 0) {
+            void* mapped = mmap(nullptr, textSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                throw runtime_error("Cannot map dictionary " + path + ": " + strerror(errno));
+            }
+            text = static_cast<char*>(mapped);
+            madvise(text, textSize, MADV_SEQUENTIAL);
+        }
+        close(fd);
+        build();
+    }
+
+    Dictionary(const Dictionary&) = delete; // text may point into the object itself
+    Dictionary& operator=(const Dictionary&) = delete;
+
+    ~Dictionary() {
+        if (text != nullptr && builtInText.empty()) munmap(text, textSize);
+    }
+
+    size_t size() const { return offsets.size(); }
+    uint32_t mask(size_t index) const { return masks[index]; }
+    string_view word(size_t index, size_t length) const { return string_view(text + offsets[index], length); }
+
+    // Function to find the words of a length (0 for any) and difficulty (anyDifficulty for any).
+    // With both given the words are [first, first + count); otherwise see randomWord.
+    size_t count(size_t length, int difficulty) const {
+        if (length > maxWordLength) return 0;
+        if (length == 0 && difficulty == anyDifficulty) return offsets.size();
+        if (length == 0) {
+            size_t total = 0;
+            for (size_t l = 1; l <= maxWordLength; ++l) total += start[l][difficulty + 1] - start[l][difficulty];
+            return total;
+        }
+        if (difficulty == anyDifficulty) return start[length][difficultyCount] - start[length][0];
+        return start[length][difficulty + 1] - start[length][difficulty];
+    }
+
+    // Function to get the first word index of a length (and difficulty, if given)
+    size_t first(size_t length, int difficulty = anyDifficulty) const {
+        return start[min(length, maxWordLength + 1)][difficulty == anyDifficulty ? 0 : difficulty];
+    }
+
+    // Function to pick a word uniformly among those passing the filters.
+    // Returns an empty view if none do.
+    string_view randomWord(FastRandom& random, size_t length = 0, int difficulty = anyDifficulty) const {
+        size_t matches = count(length, difficulty);
+        if (matches == 0) return {};
+        size_t pick = random.below(matches);
+        if (length != 0) return word(first(length, difficulty) + pick, length);
+        // Any length: step through the (at most 32) lengths to find the one holding the pick
+        for (size_t l = 1; l <= maxWordLength; ++l) {
+            size_t here = count(l, difficulty);
+            if (pick < here) return word(first(l, difficulty) + pick, l);
+            pick -= here;
+        }
+        return {};
+    }
+
+    // Function to rate a word by its letters outside the twelve commonest in English
+    static Difficulty difficultyOf(uint32_t letterMask) {
+        static const uint32_t common = letterBits("etaoinshrdlu");
+        int uncommon = __builtin_popcount(letterMask & ~common);
+        return uncommon == 0 ? Difficulty::easy : uncommon == 1 ? Difficulty::medium : Difficulty::hard;
+    }
+
+    static uint32_t letterBits(const char* letters) {
+        uint32_t bits = 0;
+        for (; *letters; ++letters) bits |= 1u << (*letters - 'a');
+        return bits;
+    }
+
+private:
+    // Function to find the words in the text and sort them by (length, difficulty) with a counting sort
+    void build() {
+        struct Found {
+            uint32_t offset;
+            uint32_t mask;
+            uint8_t length;
+            uint8_t difficulty;
+        };
+        vector<Found> found;
+        found.reserve(textSize / 8);
+        size_t counts[maxWordLength + 1][difficultyCount] = {};
+        // One pass over the characters; each line's letters are masked as they go by
+        size_t wordStart = 0;
+        uint32_t mask = 0;
+        bool valid = true;
+        auto endWord = [&](size_t end) {
+            size_t length = end - wordStart;
+            if (length > 0 && text[end - 1] == '\r') --length;
+            if (valid && length > 0 && length <= maxWordLength) {
+                Difficulty difficulty = difficultyOf(mask);
+                found.push_back({ static_cast<uint32_t>(wordStart), mask, static_cast<uint8_t>(length),
+                                  static_cast<uint8_t>(difficulty) });
+                ++counts[length][static_cast<size_t>(difficulty)];
+            }
+            wordStart = end + 1;
+            mask = 0;
+            valid = true;
+        };
+        for (size_t i = 0; i < textSize; ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (static_cast<unsigned>(c - 'a') < 26) {
+                mask |= 1u << (c - 'a');
+            } else if (c == '\n') {
+                endWord(i);
+            } else if (static_cast<unsigned>(c - 'A') < 26) {
+                text[i] = static_cast<char>(c - 'A' + 'a');
+                mask |= 1u << (c - 'A');
+            } else if (c != '\r' || (i + 1 < textSize && text[i + 1] != '\n')) {
+                valid = false; // Only a-z (either case) make a word
+            }
+        }
+        if (wordStart < textSize) endWord(textSize);
+
+        size_t next = 0;
+        for (size_t l = 0; l <= maxWordLength + 1; ++l) {
+            for (size_t d = 0; d < difficultyCount; ++d) {
+                start[l][d] = next;
+                if (l <= maxWordLength) next += counts[l][d];
+            }
+            start[l][difficultyCount] = next;
+        }
+        offsets.resize(found.size());
+        masks.resize(found.size());
+        size_t fill[maxWordLength + 1][difficultyCount];
+        for (size_t l = 0; l <= maxWordLength; ++l) {
+            for (size_t d = 0; d < difficultyCount; ++d) fill[l][d] = start[l][d];
+        }
+        for (const Found& f : found) {
+            size_t index = fill[f.length][f.difficulty]++;
+            offsets[index] = f.offset;
+            masks[index] = f.mask;
+        }
+    }
+};
+
+// WordBucket Structure: The dictionary words of one length, stored back to
+// back. Besides a 26-bit letter mask per word, it keeps bitsets with one bit
+// per word: the words containing each letter, and the words with each
+// letter at each position. A guess then narrows the candidates with a few
+// AND/AND-NOT passes over 64-bit words instead of rescanning the strings.
+struct WordBucket {
+    size_t length = 0;          // Letters in every word of the bucket
+    size_t count = 0;           // Number of words
+    size_t blocks = 0;          // 64-bit words per bitset
+    vector<char> letters;       // The words, length letters each
+    vector<uint32_t> masks;     // Bit (letter - 'a') is set if the word contains letter
+    vector<uint64_t> hasLetter; // 26 bitsets: words containing each letter
+    vector<uint64_t> letterAt;  // length * 26 bitsets: words with each letter at each position
+    char opening[2] = {};       // First guess for each Strategy, the same in every game of this length
+
+    const char* word(size_t index) const { return letters.data() + index * length; }
+    const uint64_t* withLetter(int letter) const { return hasLetter.data() + letter * blocks; }
+    const uint64_t* withLetterAt(size_t position, int letter) const {
+        return letterAt.data() + (position * 26 + letter) * blocks;
+    }
+};
+
+// Enum for how the solver picks its next letter
+enum class Strategy { frequency, informationGain };
+
+// HangmanSolver Class: A dictionary bucketed by word length, ready for
+// SolverGame to guess against
+class HangmanSolver {
+private:
+    vector<WordBucket> buckets; // Indexed by word length
+
+public:
+    static constexpr size_t maxWordLength = Dictionary::maxWordLength;
+
+    // Function to copy each length's words out of the dictionary and index them
+    explicit HangmanSolver(const Dictionary& dictionary) {
+        buckets.resize(maxWordLength + 1);
+        for (size_t length = 1; length <= maxWordLength; ++length) {
+            WordBucket& bucket = buckets[length];
+            bucket.count = dictionary.count(length, anyDifficulty);
+            if (bucket.count == 0) continue;
+            bucket.length = length;
+            size_t first = dictionary.first(length);
+            bucket.letters.reserve(bucket.count * length);
+            bucket.masks.reserve(bucket.count);
+            for (size_t i = first; i < first + bucket.count; ++i) {
+                string_view word = dictionary.word(i, length);
+                bucket.letters.insert(bucket.letters.end(), word.begin(), word.end());
+                bucket.masks.push_back(dictionary.mask(i));
+            }
+            index(bucket);
+        }
+        chooseOpenings();
+    }
+
+    const WordBucket& bucket(size_t length) const { return buckets[min(length, maxWordLength)]; }
+
+    size_t wordCount() const {
+        size_t total = 0;
+        for (const WordBucket& b : buckets) total += b.count;
+        return total;
+    }
+
+private:
+    void chooseOpenings(); // Defined after SolverGame
+
+    // Function to fill in a bucket's bitsets from its words and masks
+    static void index(WordBucket& bucket) {
+        bucket.blocks = (bucket.count + 63) / 64;
+        bucket.hasLetter.assign(26 * bucket.blocks, 0);
+        bucket.letterAt.assign(bucket.length * 26 * bucket.blocks, 0);
+        for (size_t i = 0; i < bucket.count; ++i) {
+            const char* word = bucket.word(i);
+            uint64_t bit = uint64_t(1) << (i % 64);
+            for (size_t p = 0; p < bucket.length; ++p) {
+                int letter = word[p] - 'a';
+                bucket.letterAt[(p * 26 + letter) * bucket.blocks + i / 64] |= bit;
+            }
+            for (uint32_t m = bucket.masks[i]; m != 0; m &= m - 1) {
+                bucket.hasLetter[__builtin_ctz(m) * bucket.blocks + i / 64] |= bit;
+            }
+        }
+    }
+};
+
+// SolverGame Class: The solver's view of one game: the dictionary words
+// still consistent with the revealed pattern and the wrong guesses, as a
+// bitset over the bucket for the word's length. reset() starts a new game
+// reusing the bitset's memory.
+class SolverGame {
+private:
+    const HangmanSolver& solver;  // Dictionary being guessed from
+    const WordBucket* bucket;     // Words of the right length
+    vector<uint64_t> candidates;  // Bit set for every word still possible
+    size_t remaining = 0;         // Number of bits set in candidates
+    uint32_t guessed = 0;         // Letters guessed so far, as a 26-bit mask
+    uint32_t revealed = 0;        // Positions revealed so far, one bit each
+
+    static const size_t exactGainLimit = 1024; // Above this, information gain uses the hit/miss split only
+
+public:
+    SolverGame(const HangmanSolver& dictionary, size_t length) : solver(dictionary) { reset(length); }
+
+    // Function to start a game on a word of the given length
+    void reset(size_t length) {
+        bucket = &solver.bucket(length);
+        guessed = revealed = 0;
+        if (bucket->length != length) {
+            candidates.clear(); // No dictionary words of this length
+            remaining = 0;
+            return;
+        }
+        candidates.assign(bucket->blocks, ~uint64_t(0));
+        remaining = bucket->count;
+        if (bucket->count % 64 != 0) candidates.back() = (uint64_t(1) << (bucket->count % 64)) - 1;
+    }
+
+    size_t candidateCount() const { return remaining; }
+
+    // Function to narrow the candidates after guessing letter, given the
+    // positions where it was found (one bit each, 0 for a miss)
+    void applyGuess(char letter, uint32_t positions) {
+        int l = letter - 'a';
+        guessed |= 1u << l;
+        if (remaining == 0) return;
+        uint64_t* live = candidates.data();
+        size_t blocks = candidates.size();
+        if (positions == 0) {
+            const uint64_t* with = bucket->withLetter(l);
+            for (size_t b = 0; b < blocks; ++b) live[b] &= ~with[b];
+        } else {
+            for (size_t p = 0; p < bucket->length; ++p) {
+                if (revealed & (1u << p)) continue; // Already known to hold another letter
+                const uint64_t* at = bucket->withLetterAt(p, l);
+                if (positions & (1u << p)) {
+                    for (size_t b = 0; b < blocks; ++b) live[b] &= at[b];
+                } else {
+                    for (size_t b = 0; b < blocks; ++b) live[b] &= ~at[b];
+                }
+            }
+            revealed |= positions;
+        }
+        remaining = 0;
+        for (size_t b = 0; b < blocks; ++b) remaining += __builtin_popcountll(live[b]);
+    }
+
+    // Function to choose the next letter. Frequency picks the letter in the
+    // most candidates; information gain picks the letter whose revealed
+    // pattern splits the candidates most evenly.
+    char nextGuess(Strategy strategy) const {
+        if (guessed == 0 && bucket->opening[static_cast<int>(strategy)] != 0) {
+            return bucket->opening[static_cast<int>(strategy)];
+        }
+        size_t counts[26] = {};
+        countLetters(counts);
+        int best = -1;
+        double bestScore = -1;
+        for (int l = 0; l < 26; ++l) {
+            if (guessed & (1u << l) || counts[l] == 0) continue;
+            double score = static_cast<double>(counts[l]);
+            if (strategy == Strategy::informationGain) {
+                score = remaining <= exactGainLimit ? patternEntropy(l) : splitEntropy(counts[l]);
+            }
+            if (score > bestScore || (score == bestScore && counts[l] > counts[best])) {
+                best = l;
+                bestScore = score;
+            }
+        }
+        if (best >= 0) return static_cast<char>('a' + best);
+        // The word is not in the dictionary: fall back to English letter frequency
+        for (char c : string("etaoinshrdlcumwfgypbvkjxqz")) {
+            if (!(guessed & (1u << (c - 'a')))) return c;
+        }
+        return 'a';
+    }
+
+private:
+    // Function to count the candidates containing each letter
+    void countLetters(size_t (&counts)[26]) const {
+        if (remaining == 0) return;
+        if (remaining * 16 < bucket->count) {
+            // Few candidates left: visit them rather than every block of 26 bitsets
+            forEachCandidate([&](size_t i) {
+                for (uint32_t m = bucket->masks[i]; m != 0; m &= m - 1) ++counts[__builtin_ctz(m)];
+            });
+            return;
+        }
+        for (int l = 0; l < 26; ++l) {
+            if (guessed & (1u << l)) continue;
+            const uint64_t* with = bucket->withLetter(l);
+            size_t total = 0;
+            for (size_t b = 0; b < candidates.size(); ++b) total += __builtin_popcountll(candidates[b] & with[b]);
+            counts[l] = total;
+        }
+    }
+
+    template <typename Visit>
+    void forEachCandidate(Visit visit) const {
+        for (size_t b = 0; b < candidates.size(); ++b) {
+            for (uint64_t bits = candidates[b]; bits != 0; bits &= bits - 1) visit(b * 64 + __builtin_ctzll(bits));
+        }
+    }
+
+    // Function to compute the entropy (in bits) of whether letter is in the word
+    double splitEntropy(size_t withLetter) const {
+        double p = static_cast<double>(withLetter) / remaining;
+        if (p <= 0 || p >= 1) return 0;
+        return -(p * log2(p) + (1 - p) * log2(1 - p));
+    }
+
+    // Function to compute the entropy (in bits) of the pattern letter l would reveal
+    double patternEntropy(int l) const {
+        vector<uint32_t> patterns;
+        patterns.reserve(remaining);
+        forEachCandidate([&](size_t i) {
+            uint32_t pattern = 0;
+            if (bucket->masks[i] & (1u << l)) {
+                const char* word = bucket->word(i);
+                for (size_t p = 0; p < bucket->length; ++p) pattern |= uint32_t(word[p] - 'a' == l) << p;
+            }
+            patterns.push_back(pattern);
+        });
+        sort(patterns.begin(), patterns.end());
+        double entropy = 0;
+        for (size_t start = 0; start < patterns.size();) {
+            size_t end = start;
+            while (end < patterns.size() && patterns[end] == patterns[start]) ++end;
+            double p = static_cast<double>(end - start) / patterns.size();
+            entropy -= p * log2(p);
+            start = end;
+        }
+        return entropy;
+    }
+};
+
+// Function to work out each bucket's first guess once, instead of in every game
+void HangmanSolver::chooseOpenings() {
+    for (WordBucket& bucket : buckets) {
+        if (bucket.count == 0) continue;
+        SolverGame game(*this, bucket.length);
+        bucket.opening[static_cast<int>(Strategy::frequency)] = game.nextGuess(Strategy::frequency);
+        bucket.opening[static_cast<int>(Strategy::informationGain)] = game.nextGuess(Strategy::informationGain);
+    }
+}
+
+// HangmanGame Class: The rules of one game, with no input or output, so a
+// person at the terminal and a program can both drive it. The whole state
+// is a view of the word and a few integers: guessed letters are a 26-bit
+// mask, so a game allocates nothing.
+class HangmanGame {
+private:
+    string_view word;          // The answer (owned by the caller)
+    uint32_t wordLetters = 0;  // Letters in the word
+    uint32_t guessed = 0;      // Letters guessed so far, right or wrong
+    int incorrect = 0;         // Wrong guesses so far
+    int maxIncorrect;          // Wrong guesses allowed
+
+public:
+    static const int defaultMaxGuesses = 6;
+
+    explicit HangmanGame(string_view answer, int maxGuesses = defaultMaxGuesses)
+        : word(answer), maxIncorrect(maxGuesses) {
+        for (char c : word) wordLetters |= 1u << (c - 'a');
+    }
+
+    string_view answer() const { return word; }
+    size_t length() const { return word.size(); }
+    uint32_t guessedLetters() const { return guessed; }
+    uint32_t incorrectLetters() const { return guessed & ~wordLetters; }
+    bool hasGuessed(char letter) const { return guessed & (1u << (letter - 'a')); }
+    int guessCount() const { return __builtin_popcount(guessed); }
+    int incorrectCount() const { return incorrect; }
+    int guessesLeft() const { return maxIncorrect - incorrect; }
+    bool won() const { return (wordLetters & ~guessed) == 0; }
+    bool lost() const { return incorrect >= maxIncorrect && !won(); }
+    bool over() const { return won() || lost(); }
+
+    // Function to show position i: its letter once guessed, otherwise '_'
+    char revealed(size_t i) const { return hasGuessed(word[i]) ? word[i] : '_'; }
+
+    // Function to guess a letter. Returns the positions where it is found,
+    // one bit each (0 for a miss). Anything but a new letter a-z counts as a miss.
+    uint32_t guess(char letter) {
+        if (letter < 'a' || letter > 'z' || hasGuessed(letter)) {
+            ++incorrect;
+            return 0;
+        }
+        guessed |= 1u << (letter - 'a');
+        uint32_t positions = 0;
+        for (size_t i = 0; i < word.size(); ++i) positions |= uint32_t(word[i] == letter) << i;
+        if (positions == 0) ++incorrect;
+        return positions;
+    }
+};
+
+// Guesser Class: Interface for a computer player. start() begins a game on
+// a word of the given length; nextGuess() picks a letter given those already
+// guessed, and observe() learns where it was found (one bit per position).
+class Guesser {
+public:
+    virtual ~Guesser() = default;
+    virtual void start(size_t length) = 0;
+    virtual char nextGuess(uint32_t guessedLetters) = 0;
+    virtual void observe(char letter, uint32_t positions) = 0;
+};
+
+// SolverGuesser Class: Guesses with the dictionary solver
+class SolverGuesser : public Guesser {
+private:
+    SolverGame game;
+    Strategy strategy;
+
+public:
+    SolverGuesser(const HangmanSolver& solver, Strategy chosen) : game(solver, 0), strategy(chosen) {}
+    void start(size_t length) override { game.reset(length); }
+    char nextGuess(uint32_t) override { return game.nextGuess(strategy); }
+    void observe(char letter, uint32_t positions) override { game.applyGuess(letter, positions); }
+};
+
+// LetterOrderGuesser Class: Guesses letters in order of English frequency, ignoring the dictionary
+class LetterOrderGuesser : public Guesser {
+public:
+    void start(size_t) override {}
+    char nextGuess(uint32_t guessedLetters) override {
+        for (char c : string_view("etaoinshrdlcumwfgypbvkjxqz")) {
+            if (!(guessedLetters & (1u << (c - 'a')))) return c;
+        }
+        return 'a';
+    }
+    void observe(char, uint32_t) override {}
+};
+
+// RandomGuesser Class: Guesses a random letter not yet tried, as a baseline
+class RandomGuesser : public Guesser {
+private:
+    FastRandom random;
+
+public:
+    explicit RandomGuesser(uint64_t seed) : random(seed) {}
+    void start(size_t) override {}
+    char nextGuess(uint32_t guessedLetters) override {
+        uint32_t left = ~guessedLetters & ((1u << 26) - 1);
+        if (left == 0) return 'a';
+        for (uint64_t skip = random.below(__builtin_popcount(left)); skip > 0; --skip) left &= left - 1;
+        return static_cast<char>('a' + __builtin_ctz(left));
+    }
+    void observe(char, uint32_t) override {}
+};
+
+// Function to create a guesser by name: frequency, entropy, letter-order or random
+unique_ptr<Guesser> makeGuesser(const string& name, const HangmanSolver& solver, uint64_t seed) {
+    if (name == "frequency") return make_unique<SolverGuesser>(solver, Strategy::frequency);
+    if (name == "entropy") return make_unique<SolverGuesser>(solver, Strategy::informationGain);
+    if (name == "letter-order") return make_unique<LetterOrderGuesser>();
+    if (name == "random") return make_unique<RandomGuesser>(seed);
+    throw runtime_error("Unknown guesser " + name + " (use frequency, entropy, letter-order or random)");
+}
+
+// Function to let a guesser play one game to the end
+void playGame(HangmanGame& game, Guesser& guesser) {
+    guesser.start(game.length());
+    while (!game.over()) {
+        char letter = guesser.nextGuess(game.guessedLetters());
+        guesser.observe(letter, game.guess(letter));
+    }
+}
+
+#ifdef __linux__
+// Session Structure: One client's connection and game, kept in a fixed-size
+// slot of the server's arena. The word is a view into the dictionary, so a
+// session owns no memory of its own.
+struct Session {
+    int fd = -1;             // Client socket (-1 while the slot is free)
+    uint32_t nextFree = 0;   // Next free slot, while this one is free
+    uint8_t inLength = 0;    // Bytes waiting in input
+    uint8_t outLength = 0;   // Bytes of output the socket has not taken yet
+    bool playing = false;    // Whether game holds a game in progress
+    bool closing = false;    // Close once the output is sent (after QUIT)
+    char input[64];          // Partial command line
+    char output[64];         // Unsent part of the last reply
+    HangmanGame game{ string_view() };
+};
+
+// SessionPool Class: Arena of sessions allocated once at startup, with a
+// free list threaded through the unused slots. Slots are found by index,
+// which is what the event loop stores with each socket.
+class SessionPool {
+private:
+    vector<Session> slots;
+    uint32_t freeHead = 0; // First free slot (slots.size() when full)
+    size_t used = 0;
+
+public:
+    explicit SessionPool(size_t capacity) : slots(capacity) {
+        for (size_t i = 0; i < capacity; ++i) slots[i].nextFree = static_cast<uint32_t>(i + 1);
+    }
+
+    // Function to take a free slot for a new connection. Returns false if the pool is full.
+    bool acquire(int fd, uint32_t& index) {
+        if (freeHead == slots.size()) return false;
+        index = freeHead;
+        Session& session = slots[index];
+        freeHead = session.nextFree;
+        session.fd = fd;
+        session.inLength = session.outLength = 0;
+        session.playing = session.closing = false;
+        ++used;
+        return true;
+    }
+
+    void release(uint32_t index) {
+        slots[index].fd = -1;
+        slots[index].nextFree = freeHead;
+        freeHead = index;
+        --used;
+    }
+
+    Session& operator[](uint32_t index) { return slots[index]; }
+    size_t size() const { return used; }
+    size_t capacity() const { return slots.size(); }
+};
+
+// Function to parse an address: a path is a Unix socket, "[host:]port" is
+// TCP (host defaults to 127.0.0.1). Returns the socket address and its length.
+socklen_t parseAddress(const string& address, sockaddr_storage& storage) {
+    memset(&storage, 0, sizeof(storage));
+    if (address.find('/') != string::npos) {
+        auto* unixAddress = reinterpret_cast<sockaddr_un*>(&storage);
+        if (address.size() >= sizeof(unixAddress->sun_path)) throw runtime_error("Socket path too long: " + address);
+        unixAddress->sun_family = AF_UNIX;
+        memcpy(unixAddress->sun_path, address.c_str(), address.size() + 1);
+        return sizeof(sockaddr_un);
+    }
+    size_t colon = address.rfind(':');
+    string host = colon == string::npos || colon == 0 ? "127.0.0.1" : address.substr(0, colon);
+    auto* inetAddress = reinterpret_cast<sockaddr_in*>(&storage);
+    inetAddress->sin_family = AF_INET;
+    inetAddress->sin_port = htons(static_cast<uint16_t>(stoul(colon == string::npos ? address : address.substr(colon + 1))));
+    if (inet_pton(AF_INET, host.c_str(), &inetAddress->sin_addr) != 1) throw runtime_error("Bad host: " + host);
+    return sizeof(sockaddr_in);
+}
+
+// Function to allow as many open sockets as the system permits
+void raiseDescriptorLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+volatile sig_atomic_t stopServer = 0; // Set by SIGINT/SIGTERM
+
+// GameServer Class: Hosts many games in one thread. An epoll loop watches
+// the listening socket and every client; each client sends one command per
+// line and gets one reply line:
+//   NEW [length [easy|medium|hard]]  ->  GAME <pattern> <guesses left>
+//   GUESS <letter>                   ->  HIT|MISS <pattern> <guesses left>, or WON|LOST <word>
+//   STATE                            ->  GAME <pattern> <guesses left>
+//   QUIT                             ->  BYE
+// Errors are answered with "ERR <reason>".
+class GameServer {
+private:
+    static const uint64_t listenerTag = UINT64_MAX; // epoll tag of the listening socket
+
+    const Dictionary& dictionary;
+    SessionPool pool;
+    FastRandom random;
+    int listenFd = -1;
+    int epollFd = -1;
+    size_t accepted = 0;  // Connections accepted
+    size_t requests = 0;  // Commands answered
+
+public:
+    GameServer(const Dictionary& words, const string& address, size_t maxSessions)
+        : dictionary(words), pool(maxSessions), random(processRandom().next()) {
+        sockaddr_storage storage;
+        socklen_t length = parseAddress(address, storage);
+        if (storage.ss_family == AF_UNIX) unlink(address.c_str()); // Replace a socket left by an earlier run
+        listenFd = socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int on = 1;
+        if (listenFd < 0 || setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+            bind(listenFd, reinterpret_cast<sockaddr*>(&storage), length) != 0 || listen(listenFd, SOMAXCONN) != 0) {
+            string reason = strerror(errno);
+            if (listenFd >= 0) close(listenFd);
+            throw runtime_error("Cannot listen on " + address + ": " + reason);
+        }
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = listenerTag;
+        if (epollFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) != 0) {
+            close(listenFd);
+            throw runtime_error("Cannot start event loop: " + string(strerror(errno)));
+        }
+    }
+
+    GameServer(const GameServer&) = delete;
+    GameServer& operator=(const GameServer&) = delete;
+
+    ~GameServer() {
+        for (uint32_t i = 0; i < pool.capacity(); ++i) {
+            if (pool[i].fd >= 0) close(pool[i].fd);
+        }
+        close(epollFd);
+        close(listenFd);
+    }
+
+    size_t connectionsAccepted() const { return accepted; }
+    size_t requestsAnswered() const { return requests; }
+
+    // Function to serve clients until SIGINT or SIGTERM
+    void run() {
+        epoll_event events[1024];
+        while (!stopServer) {
+            int ready = epoll_wait(epollFd, events, 1024, -1);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                throw runtime_error("epoll_wait failed: " + string(strerror(errno)));
+            }
+            for (int i = 0; i < ready; ++i) {
+                if (events[i].data.u64 == listenerTag) {
+                    acceptAll();
+                    continue;
+                }
+                uint32_t index = static_cast<uint32_t>(events[i].data.u64);
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    closeSession(index);
+                } else if (events[i].events & EPOLLOUT) {
+                    onWritable(index);
+                } else if (events[i].events & EPOLLIN) {
+                    onReadable(index);
+                }
+            }
+        }
+    }
+
+private:
+    void acceptAll() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return; // EAGAIN once the backlog is empty (other errors are retried on the next wakeup)
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // Fails harmlessly on Unix sockets
+            uint32_t index;
+            if (!pool.acquire(fd, index)) {
+                const char full[] = "ERR server full\n";
+                send(fd, full, sizeof(full) - 1, MSG_NOSIGNAL);
+                close(fd);
+                continue;
+            }
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = index;
+            if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                close(fd);
+                pool.release(index);
+                continue;
+            }
+            ++accepted;
+        }
+    }
+
+    void closeSession(uint32_t index) {
+        close(pool[index].fd); // Also removes it from the epoll set
+        pool.release(index);
+    }
+
+    void watch(Session& session, uint32_t index, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = index;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, session.fd, &event);
+    }
+
+    void onReadable(uint32_t index) {
+        Session& session = pool[index];
+        ssize_t got = read(session.fd, session.input + session.inLength, sizeof(session.input) - session.inLength);
+        if (got <= 0) {
+            if (got < 0 && (errno == EAGAIN || errno == EINTR)) return;
+            closeSession(index); // The client hung up
+            return;
+        }
+        session.inLength = static_cast<uint8_t>(session.inLength + got);
+        processLines(index);
+    }
+
+    void onWritable(uint32_t index) {
+        Session& session = pool[index];
+        ssize_t sent = send(session.fd, session.output, session.outLength, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EINTR) closeSession(index);
+            return;
+        }
+        memmove(session.output, session.output + sent, session.outLength - sent);
+        session.outLength = static_cast<uint8_t>(session.outLength - sent);
+        if (session.outLength > 0) return;
+        if (session.closing) {
+            closeSession(index);
+            return;
+        }
+        watch(session, index, EPOLLIN);
+        processLines(index); // Commands that arrived while the reply was stuck
+    }
+
+    // Function to answer each complete line in the input, stopping while a reply is unsent
+    void processLines(uint32_t index) {
+        Session& session = pool[index];
+        size_t start = 0;
+        while (session.outLength == 0 && !session.closing) {
+            char* newline = static_cast<char*>(memchr(session.input + start, '\n', session.inLength - start));
+            if (newline == nullptr) break;
+            size_t end = static_cast<size_t>(newline - session.input);
+            size_t length = end - start;
+            if (length > 0 && session.input[end - 1] == '\r') --length;
+            char reply[64];
+            size_t replyLength = answer(session, string_view(session.input + start, length), reply);
+            ++requests;
+            start = end + 1;
+            if (!sendReply(session, index, reply, replyLength)) return; // Session was closed
+        }
+        memmove(session.input, session.input + start, session.inLength - start);
+        session.inLength = static_cast<uint8_t>(session.inLength - start);
+        if (session.inLength == sizeof(session.input)) {
+            char reply[] = "ERR line too long\n";
+            session.closing = true;
+            if (sendReply(session, index, reply, sizeof(reply) - 1) && session.outLength == 0) closeSession(index);
+        } else if (session.closing && session.outLength == 0) {
+            closeSession(index);
+        }
+    }
+
+    // Function to send a reply, keeping whatever the socket cannot take yet.
+    // Returns false if the session had to be closed.
+    bool sendReply(Session& session, uint32_t index, const char* reply, size_t length) {
+        ssize_t sent = send(session.fd, reply, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                closeSession(index);
+                return false;
+            }
+            sent = 0;
+        }
+        if (static_cast<size_t>(sent) < length) {
+            memcpy(session.output, reply + sent, length - sent);
+            session.outLength = static_cast<uint8_t>(length - sent);
+            watch(session, index, EPOLLOUT); // Stop reading until the reply is out
+        }
+        return true;
+    }
+
+    // Function to carry out one command and write the reply line; returns its length
+    size_t answer(Session& session, string_view line, char* reply) {
+        string_view command = nextToken(line);
+        string_view argument = nextToken(line);
+        size_t length = 0;
+        auto put = [&](string_view text) {
+            memcpy(reply + length, text.data(), text.size());
+            length += text.size();
+        };
+        auto putGame = [&](string_view tag) {
+            put(tag);
+            put(" ");
+            for (size_t i = 0; i < session.game.length(); ++i) reply[length++] = session.game.revealed(i);
+            put(" ");
+            reply[length++] = static_cast<char>('0' + session.game.guessesLeft());
+        };
+
+        if (command == "NEW") {
+            size_t wordLength = 0;
+            int difficulty = anyDifficulty;
+            for (char c : argument) wordLength = c >= '0' && c <= '9' ? wordLength * 10 + (c - '0') : 99;
+            string_view level = nextToken(line);
+            if (!level.empty()) difficulty = level == "easy" ? 0 : level == "medium" ? 1 : level == "hard" ? 2 : -2;
+            string_view word = difficulty == -2 ? string_view() : dictionary.randomWord(random, wordLength, difficulty);
+            if (word.empty()) {
+                put("ERR no such words");
+            } else {
+                session.game = HangmanGame(word);
+                session.playing = true;
+                putGame("GAME");
+            }
+        } else if (command == "GUESS") {
+            char letter = argument.size() == 1 ? static_cast<char>(tolower(static_cast<unsigned char>(argument[0]))) : 0;
+            if (!session.playing) {
+                put("ERR no game");
+            } else if (letter < 'a' || letter > 'z') {
+                put("ERR guess one letter");
+            } else if (session.game.hasGuessed(letter)) {
+                put("ERR already guessed");
+            } else {
+                uint32_t positions = session.game.guess(letter);
+                if (session.game.over()) {
+                    put(session.game.won() ? "WON " : "LOST ");
+                    put(session.game.answer());
+                    session.playing = false;
+                } else {
+                    putGame(positions != 0 ? "HIT" : "MISS");
+                }
+            }
+        } else if (command == "STATE") {
+            if (session.playing) {
+                putGame("GAME");
+            } else {
+                put("ERR no game");
+            }
+        } else if (command == "QUIT") {
+            put("BYE");
+            session.closing = true;
+        } else {
+            put("ERR unknown command");
+        }
+        reply[length++] = '\n';
+        return length;
+    }
+
+    // Function to split the first space-separated word off a line
+    static string_view nextToken(string_view& line) {
+        size_t begin = line.find_first_not_of(' ');
+        if (begin == string_view::npos) {
+            line = {};
+            return {};
+        }
+        size_t end = min(line.find(' ', begin), line.size());
+        string_view token = line.substr(begin, end - begin);
+        line.remove_prefix(end);
+        return token;
+    }
+};
+#endif
+
 // Function declarations
 void displayInstructions();
-string selectRandomWord(const vector<string>& wordList);  // Function to select a random word
-void displayState(const string& word, const string& guessedWord, const unordered_set<char>& incorrectGuesses, int guessesLeft);  // Display current game state
-bool isWordGuessed(const string& word, const string& guessedWord);  // Check if the word is fully guessed
-char getValidatedGuess(const unordered_set<char>& guessedLetters);  // Get a valid letter guess from the user
-void playHangman();  // Main function to handle game flow
+string selectRandomWord(const Dictionary& dictionary, size_t length, int difficulty);  // Function to select a random word
+void displayState(const HangmanGame& game);  // Display current game state
+char getValidatedGuess(const HangmanGame& game);  // Get a valid letter guess from the user
+void playHangman(const Dictionary& dictionary, size_t length, int difficulty);  // Main function to handle game flow
+bool solveWord(const HangmanSolver& solver, string_view word, Strategy strategy, int& incorrect,
+               size_t& decisions, double& decisionSeconds);  // Let the solver play one game
+int runSolver(const string& dictionaryPath, Strategy strategy, size_t games);  // Evaluate the solver on a dictionary
+int runSimulation(const string& dictionaryPath, const string& guesserName, size_t games, unsigned threads,
+                  size_t length, int difficulty, uint64_t seed);  // Play many headless games in parallel
+#ifdef __linux__
+int runServer(const Dictionary& dictionary, const string& address, size_t maxSessions);  // Host games over sockets
+int runLoad(const string& address, size_t sessions, double seconds, unsigned threads);  // Measure a running server
+#endif
+
+int main(int argc, char* argv[]) {
+    // "--solve dictionary [frequency|entropy] [games]" lets the solver play
+    // words from a dictionary file (one word per line) and prints how it did
+    if (argc > 2 && string(argv[1]) == "--solve") {
+        try {
+            string strategy = argc > 3 ? argv[3] : "frequency";
+            if (strategy != "frequency" && strategy != "entropy") {
+                cerr << "Unknown strategy " << strategy << " (use frequency or entropy).\n";
+                return 1;
+            }
+            size_t games = argc > 4 ? stoul(argv[4]) : 10000;
+            return runSolver(argv[2], strategy == "entropy" ? Strategy::informationGain : Strategy::frequency, games);
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // "--simulate dictionary [--guesser name] [--games N] [--threads N] [--length N]
+    // [--difficulty easy|medium|hard] [--seed N]" plays games without a terminal
+    if (argc > 2 && string(argv[1]) == "--simulate") {
+        try {
+            string guesser = "frequency";
+            size_t games = 1000000, length = 0;
+            unsigned threads = max(thread::hardware_concurrency(), 1u);
+            int difficulty = anyDifficulty;
+            uint64_t seed = 42;
+            for (int i = 3; i + 1 < argc; i += 2) {
+                string option = argv[i], value = argv[i + 1];
+                if (option == "--guesser") {
+                    guesser = value;
+                } else if (option == "--games") {
+                    games = stoul(value);
+                } else if (option == "--threads") {
+                    threads = max(static_cast<unsigned>(stoul(value)), 1u);
+                } else if (option == "--length") {
+                    length = stoul(value);
+                } else if (option == "--difficulty") {
+                    difficulty = value == "easy" ? 0 : value == "medium" ? 1 : value == "hard" ? 2 : anyDifficulty;
+                } else if (option == "--seed") {
+                    seed = stoull(value);
+                } else {
+                    cerr << "Unknown option " << option << "\n";
+                    return 1;
+                }
+            }
+            return runSimulation(argv[2], guesser, games, threads, length, difficulty, seed);
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // "--serve address [--dictionary path] [--max-sessions N]" hosts games for
+    // clients on a Unix socket (a path) or loopback TCP ("[host:]port");
+    // "--load address [--sessions N] [--seconds S] [--threads N]" measures such a server
+    if (argc > 2 && (string(argv[1]) == "--serve" || string(argv[1]) == "--load")) {
+#ifdef __linux__
+        try {
+            string dictionaryPath;
+            size_t maxSessions = 100000, sessions = 1000;
+            double seconds = 10;
+            unsigned threads = max(thread::hardware_concurrency(), 1u);
+            for (int i = 3; i + 1 < argc; i += 2) {
+                string option = argv[i], value = argv[i + 1];
+                if (option == "--dictionary") {
+                    dictionaryPath = value;
+                } else if (option == "--max-sessions") {
+                    maxSessions = max<size_t>(stoul(value), 1);
+                } else if (option == "--sessions") {
+                    sessions = max<size_t>(stoul(value), 1);
+                } else if (option == "--seconds") {
+                    seconds = stod(value);
+                } else if (option == "--threads") {
+                    threads = max(static_cast<unsigned>(stoul(value)), 1u);
+                } else {
+                    cerr << "Unknown option " << option << "\n";
+                    return 1;
+                }
+            }
+            if (string(argv[1]) == "--load") return runLoad(argv[2], sessions, seconds, threads);
+            Dictionary dictionary(dictionaryPath);
+            return runServer(dictionary, argv[2], maxSessions);
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+#else
+        cerr << "Error: The game server needs Linux (epoll).\n";
+        return 1;
+#endif
+    }
+
+    // "[--dictionary path] [--length N] [--difficulty easy|medium|hard]" chooses
+    // where the words come from and which of them are played
+    string dictionaryPath;
+    size_t length = 0;  // Any length
+    int difficulty = anyDifficulty;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i], value = argv[i + 1];
+        if (option == "--dictionary") {
+            dictionaryPath = value;
+        } else if (option == "--length") {
+            length = stoul(value);
+        } else if (option == "--difficulty") {
+            difficulty = value == "easy" ? 0 : value == "medium" ? 1 : value == "hard" ? 2 : anyDifficulty;
+        } else {
+            cerr << "Unknown option " << option << "\n";
+            return 1;
+        }
+    }
+    unique_ptr<Dictionary> loaded;
+    try {
+        loaded = make_unique<Dictionary>(dictionaryPath);
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    const Dictionary& dictionary = *loaded;
+    if (dictionary.size() == 0) {
+        cerr << "Error: The dictionary has no usable words.\n";
+        return 1;
+    }
 
-int main() {
     displayInstructions();
-    char playAgain;
-    do {
-        playHangman();  // Call the game function to start a game
-        cout << "Do you want to play again? (y/n): ";
-        cin >> playAgain;
-        playAgain = tolower(playAgain);  // Convert input to lowercase
-    } while (playAgain == 'y');  // Continue playing if the user enters 'y'
+    char playAgain = 'n';
+    try {
+        do {
+            playHangman(dictionary, length, difficulty);  // Call the game function to start a game
+            cout << "Do you want to play again? (y/n): ";
+            cin >> playAgain;
+            playAgain = tolower(playAgain);  // Convert input to lowercase
+        } while (playAgain == 'y');  // Continue playing if the user enters 'y'
+    } catch (const exception& e) {
+        cerr << "\n" << e.what() << "\n";
+    }
     return 0;
 }
 
-// Function to select a random word from the list
-string selectRandomWord(const vector<string>& wordList) {
-    srand(static_cast<unsigned int>(time(nullptr)));  // Seed the random number generator with current time
-    int randomIndex = rand() % wordList.size();  // Select a random index within the word list
-    return wordList[randomIndex];  // Return the word at the random index
+// Function to select a random word of the given length and difficulty
+// (0 and anyDifficulty for any), falling back to any word if none match
+string selectRandomWord(const Dictionary& dictionary, size_t length, int difficulty) {
+    string_view word = dictionary.randomWord(processRandom(), length, difficulty);
+    if (word.empty()) {
+        cout << "No words match that length and difficulty; choosing from all words.\n";
+        word = dictionary.randomWord(processRandom());
+    }
+    return string(word);
 }
 
 // Function to display the current game state
-void displayState(const string& word, const string& guessedWord, const unordered_set<char>& incorrectGuesses, int guessesLeft) {
+void displayState(const HangmanGame& game) {
     cout << "\nWord: ";
-    for (char c : guessedWord) {  // Display the guessed word with spaces between letters
-        cout << c << " ";
+    for (size_t i = 0; i < game.length(); ++i) {  // Display the guessed word with spaces between letters
+        cout << game.revealed(i) << " ";
     }
     cout << "\nIncorrect Guesses: ";
-    for (char c : incorrectGuesses) {  // Display the incorrect guesses so far
-        cout << c << " ";
+    for (uint32_t m = game.incorrectLetters(); m != 0; m &= m - 1) {  // Display the incorrect guesses so far
+        cout << static_cast<char>('a' + __builtin_ctz(m)) << " ";
     }
-    cout << "\nGuesses Left: " << guessesLeft << "\n";  // Show how many guesses are left
-}
-
-// Function to check if the word has been guessed
-bool isWordGuessed(const string& word, const string& guessedWord) {
-    return word == guessedWord;  // Return true if the word and guessed word are identical
+    cout << "\nGuesses Left: " << game.guessesLeft() << "\n";  // Show how many guesses are left
 }
 
 // Function to get a validated guess from the user
-char getValidatedGuess(const unordered_set<char>& guessedLetters) {
+char getValidatedGuess(const HangmanGame& game) {
     char guess;
     while (true) {
         cout << "Guess a letter: ";
-        cin >> guess;
+        if (!(cin >> guess)) throw runtime_error("Input ended.");  // Stop rather than ask forever
         guess = tolower(guess);  // Convert the guess to lowercase
 
         // Check if the input is a valid letter
-        if (!isalpha(guess)) {
+        if (guess < 'a' || guess > 'z') {
             cout << "Invalid input. Please enter a single letter.\n";
             continue;  // Ask for a new guess if the input is invalid
         }
 
         // Check if the letter has already been guessed
-        if (guessedLetters.find(guess) != guessedLetters.end()) {
+        if (game.hasGuessed(guess)) {
             cout << "You've already guessed that letter. Try again.\n";
             continue;  // Ask for a new guess if the letter was already guessed
         }
@@ -77,50 +1201,309 @@ char getValidatedGuess(const unordered_set<char>& guessedLetters) {
     }
 }
 
-// Function to play the Hangman game
-void playHangman() {
-    // Predefined list of words for the game
-    vector<string> wordList = {"teacher", "programming", "hangman", "difficulty", "keyboard", "developer", "algorithm"};
-    string word = selectRandomWord(wordList);  // Select a random word from the list
-    string guessedWord(word.size(), '_');  // Initialize the guessed word as all underscores
-    unordered_set<char> incorrectGuesses;  // Set to keep track of incorrect guesses
-    unordered_set<char> guessedLetters;  // Set to keep track of all guessed letters (correct or incorrect)
+// Function to play the Hangman game at the terminal
+void playHangman(const Dictionary& dictionary, size_t length, int difficulty) {
+    string word = selectRandomWord(dictionary, length, difficulty);  // Select a random word from the dictionary
+    HangmanGame game(word);  // The game's rules and state; this function only does the talking
+
+    while (!game.over()) {
+        displayState(game);  // Display the current game state
+
+        // Get a valid guess from the user and check it against the word
+        if (game.guess(getValidatedGuess(game)) != 0) {
+            cout << "Good guess!\n";
+        } else {
+            cout << "Incorrect guess.\n";
+        }
+    }
+
+    if (game.won()) {
+        displayState(game);  // Display the final state
+        cout << "Congratulations! You guessed the word \"" << word << "\" correctly!\n";
+    } else {
+        cout << "Sorry, you've run out of guesses. The correct word was \"" << word << "\".\n";  // Display the correct word if the player loses
+    }
+}
+
+// Function to let the solver play one game of word with the usual six
+// wrong guesses. Counts its decisions and the time they took.
+bool solveWord(const HangmanSolver& solver, string_view word, Strategy strategy, int& incorrect,
+               size_t& decisions, double& decisionSeconds) {
+    HangmanGame game(word);
+    SolverGame solverGame(solver, word.size());
+    while (!game.over()) {
+        auto start = chrono::steady_clock::now();
+        char guess = solverGame.nextGuess(strategy);
+        decisionSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        ++decisions;
+
+        uint32_t positions = game.guess(guess);
+        start = chrono::steady_clock::now();
+        solverGame.applyGuess(guess, positions);
+        decisionSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    incorrect = game.incorrectCount();
+    return game.won();
+}
+
+// Function to play the solver against up to games words spread evenly over
+// the dictionary and print the win rate and the time per decision
+int runSolver(const string& dictionaryPath, Strategy strategy, size_t games) {
+    auto start = chrono::steady_clock::now();
+    Dictionary dictionary(dictionaryPath);
+    double loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    start = chrono::steady_clock::now();
+    HangmanSolver solver(dictionary);
+    double indexSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    size_t words = solver.wordCount();
+    if (words == 0) throw runtime_error("No usable words in " + dictionaryPath);
+    cout << "Loaded " << words << " words in " << loadSeconds * 1e3 << " ms, indexed for the solver in "
+         << indexSeconds * 1e3 << " ms\n";
+
+    size_t step = max<size_t>(words / max<size_t>(games, 1), 1);
+    size_t played = 0, won = 0, index = 0, decisions = 0;
+    long totalIncorrect = 0;
+    double decisionSeconds = 0;
+    for (size_t length = 1; length <= HangmanSolver::maxWordLength; ++length) {
+        const WordBucket& bucket = solver.bucket(length);
+        if (bucket.length != length) continue;
+        for (size_t i = 0; i < bucket.count && played < games; ++i, ++index) {
+            if (index % step != 0) continue;
+            int incorrect;
+            won += solveWord(solver, string_view(bucket.word(i), length), strategy, incorrect, decisions,
+                             decisionSeconds);
+            totalIncorrect += incorrect;
+            ++played;
+        }
+    }
+    cout << "Games: " << played << "\n"
+         << "Won: " << won << " (" << 100.0 * won / max<size_t>(played, 1) << "%)\n"
+         << "Average wrong guesses: " << static_cast<double>(totalIncorrect) / max<size_t>(played, 1) << "\n"
+         << "Time per decision: " << 1e6 * decisionSeconds / max<size_t>(decisions, 1) << " us\n";
+    return 0;
+}
+
+// Structure for the results of simulated games
+struct SimulationStats {
+    size_t games = 0;
+    size_t won = 0;
+    size_t byGuesses[27] = {};    // Games by the number of letters guessed
+    size_t wonByGuesses[27] = {}; // Of those, the games won
 
-    int maxGuesses = 6;  // Maximum number of incorrect guesses allowed
-    int guessesLeft = maxGuesses;  // Initialize the number of guesses left
+    void add(const SimulationStats& other) {
+        games += other.games;
+        won += other.won;
+        for (int i = 0; i < 27; ++i) {
+            byGuesses[i] += other.byGuesses[i];
+            wonByGuesses[i] += other.wonByGuesses[i];
+        }
+    }
+};
 
-    while (guessesLeft > 0) {
-        displayState(word, guessedWord, incorrectGuesses, guessesLeft);  // Display the current game state
+// Function to play games headless, split across threads, each with its own
+// guesser and random words drawn with the length and difficulty filters.
+// Results depend only on the seed and thread count.
+int runSimulation(const string& dictionaryPath, const string& guesserName, size_t games, unsigned threads,
+                  size_t length, int difficulty, uint64_t seed) {
+    Dictionary dictionary(dictionaryPath);
+    if (dictionary.count(length, difficulty) == 0) throw runtime_error("No words match that length and difficulty");
+    HangmanSolver solver(dictionary);
+    makeGuesser(guesserName, solver, seed); // Fail on an unknown name before starting threads
+
+    vector<SimulationStats> results(threads);
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            FastRandom random(seed * 0x9e3779b97f4a7c15ull + t);
+            unique_ptr<Guesser> guesser = makeGuesser(guesserName, solver, random.next());
+            SimulationStats stats;
+            size_t share = games / threads + (t < games % threads ? 1 : 0);
+            for (size_t g = 0; g < share; ++g) {
+                HangmanGame game(dictionary.randomWord(random, length, difficulty));
+                playGame(game, *guesser);
+                ++stats.games;
+                ++stats.byGuesses[game.guessCount()];
+                if (game.won()) {
+                    ++stats.won;
+                    ++stats.wonByGuesses[game.guessCount()];
+                }
+            }
+            results[t] = stats;
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    SimulationStats total;
+    for (const SimulationStats& stats : results) total.add(stats);
+    cout << "Guesser: " << guesserName << ", " << threads << " thread(s)\n"
+         << "Games: " << total.games << "\n"
+         << "Won: " << total.won << " (" << 100.0 * total.won / max<size_t>(total.games, 1) << "%)\n"
+         << "Games per second: " << static_cast<long>(total.games / max(seconds, 1e-9)) << "\n"
+         << "Guesses  Games  Won\n";
+    for (int i = 0; i < 27; ++i) {
+        if (total.byGuesses[i] != 0) cout << i << "  " << total.byGuesses[i] << "  " << total.wonByGuesses[i] << "\n";
+    }
+    return 0;
+}
+
+#ifdef __linux__
+// Function to serve games on address until interrupted
+int runServer(const Dictionary& dictionary, const string& address, size_t maxSessions) {
+    raiseDescriptorLimit();
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, [](int) { stopServer = 1; });
+    signal(SIGTERM, [](int) { stopServer = 1; });
+    GameServer server(dictionary, address, maxSessions);
+    cout << "Serving " << dictionary.size() << " words on " << address << " for up to " << maxSessions
+         << " sessions (" << sizeof(Session) << " bytes each, " << maxSessions * sizeof(Session) / 1e6 << " MB)\n"
+         << flush;
+    server.run();
+    cout << "Stopped after " << server.connectionsAccepted() << " connections and " << server.requestsAnswered()
+         << " requests.\n";
+    if (address.find('/') != string::npos) unlink(address.c_str());
+    return 0;
+}
 
-        // Get a valid guess from the user
-        char guess = getValidatedGuess(guessedLetters);
-        guessedLetters.insert(guess);  // Add the guessed letter to the set of guessed letters
+// Structure for one load-generator connection, which plays games back to back
+struct LoadConnection {
+    int fd = -1;
+    uint32_t guessed = 0;    // Letters guessed in the current game
+    uint64_t sentAt = 0;     // When the outstanding request was sent (ns)
+    uint8_t inLength = 0;
+    char input[64];
+};
 
-        // Check if the guessed letter is in the word
-        bool correct = false;
-        for (size_t i = 0; i < word.size(); ++i) {
-            if (word[i] == guess) {
-                guessedWord[i] = guess;  // Reveal the guessed letter in the guessed word
-                correct = true;  // Mark that the guess was correct
+// Structure for what one load-generator thread measured
+struct LoadStats {
+    size_t requests = 0;
+    size_t games = 0;
+    size_t errors = 0;
+    vector<uint32_t> latencies; // Round-trip time of each request (ns)
+};
+
+// Function to time a steady clock in nanoseconds
+uint64_t nowNanoseconds() {
+    return static_cast<uint64_t>(
+        chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Function to drive sessions connections for the given time, each with one
+// request outstanding: start a game, guess in letter order until it ends, repeat
+void loadThread(const string& address, size_t sessions, double seconds, LoadStats& stats) {
+    sockaddr_storage storage;
+    socklen_t addressLength = parseAddress(address, storage);
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    vector<LoadConnection> connections(sessions);
+    LetterOrderGuesser guesser;
+    auto request = [&](LoadConnection& connection, const char* text, size_t length) {
+        connection.sentAt = nowNanoseconds();
+        if (send(connection.fd, text, length, MSG_NOSIGNAL) != static_cast<ssize_t>(length)) ++stats.errors;
+    };
+
+    for (size_t i = 0; i < sessions; ++i) {
+        LoadConnection& connection = connections[i];
+        connection.fd = socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (connection.fd < 0 || connect(connection.fd, reinterpret_cast<sockaddr*>(&storage), addressLength) != 0) {
+            throw runtime_error("Cannot connect to " + address + ": " + strerror(errno));
+        }
+        int on = 1;
+        setsockopt(connection.fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, connection.fd, &event);
+    }
+    stats.latencies.reserve(1 << 20);
+    for (LoadConnection& connection : connections) request(connection, "NEW\n", 4);
+
+    uint64_t deadline = nowNanoseconds() + static_cast<uint64_t>(seconds * 1e9);
+    epoll_event events[1024];
+    while (nowNanoseconds() < deadline) {
+        int ready = epoll_wait(epollFd, events, 1024, 100);
+        for (int e = 0; e < ready; ++e) {
+            LoadConnection& connection = connections[events[e].data.u64];
+            ssize_t got = read(connection.fd, connection.input + connection.inLength,
+                               sizeof(connection.input) - connection.inLength);
+            if (got <= 0) throw runtime_error("Server closed a connection");
+            connection.inLength = static_cast<uint8_t>(connection.inLength + got);
+            char* newline = static_cast<char*>(memchr(connection.input, '\n', connection.inLength));
+            if (newline == nullptr) continue;
+            uint64_t now = nowNanoseconds();
+            stats.latencies.push_back(static_cast<uint32_t>(min<uint64_t>(now - connection.sentAt, UINT32_MAX)));
+            ++stats.requests;
+
+            string_view reply(connection.input, static_cast<size_t>(newline - connection.input));
+            bool finished = reply.substr(0, 4) == "WON " || reply.substr(0, 5) == "LOST ";
+            if (reply.substr(0, 4) == "ERR ") ++stats.errors;
+            connection.inLength = 0; // One request outstanding, so one reply line
+            if (finished || reply.substr(0, 4) == "ERR ") {
+                stats.games += finished;
+                connection.guessed = 0;
+                request(connection, "NEW\n", 4);
+            } else {
+                char letter = guesser.nextGuess(connection.guessed);
+                connection.guessed |= 1u << (letter - 'a');
+                char guess[] = { 'G', 'U', 'E', 'S', 'S', ' ', letter, '\n' };
+                request(connection, guess, sizeof(guess));
             }
         }
+    }
+    for (LoadConnection& connection : connections) close(connection.fd);
+    close(epollFd);
+}
 
-        if (correct) {
-            cout << "Good guess!\n";
-            if (isWordGuessed(word, guessedWord)) {  // Check if the word has been fully guessed
-                displayState(word, guessedWord, incorrectGuesses, guessesLeft);  // Display the final state
-                cout << "Congratulations! You guessed the word \"" << word << "\" correctly!\n";
-                return;  // End the game after guessing the word correctly
+// Function to load a server with many sessions from several threads and
+// print the request rate and latency percentiles
+int runLoad(const string& address, size_t sessions, double seconds, unsigned threads) {
+    raiseDescriptorLimit();
+    threads = static_cast<unsigned>(max<size_t>(min<size_t>(threads, sessions), 1));
+    vector<LoadStats> results(threads);
+    vector<string> failures(threads);
+    vector<thread> workers;
+    auto start = chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; ++t) {
+        size_t share = sessions / threads + (t < sessions % threads ? 1 : 0);
+        workers.emplace_back([&, t, share] {
+            try {
+                loadThread(address, share, seconds, results[t]);
+            } catch (const exception& e) {
+                failures[t] = e.what();
             }
-        } else {
-            cout << "Incorrect guess.\n";
-            incorrectGuesses.insert(guess);  // Add the incorrect guess to the set of incorrect guesses
-            --guessesLeft;  // Decrease the number of guesses left
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (const string& failure : failures) {
+        if (!failure.empty()) {
+            cerr << "Error: " << failure << "\n";
+            return 1;
         }
     }
 
-    cout << "Sorry, you've run out of guesses. The correct word was \"" << word << "\".\n";  // Display the correct word if the player loses
+    LoadStats total;
+    for (LoadStats& stats : results) {
+        total.requests += stats.requests;
+        total.games += stats.games;
+        total.errors += stats.errors;
+        total.latencies.insert(total.latencies.end(), stats.latencies.begin(), stats.latencies.end());
+    }
+    sort(total.latencies.begin(), total.latencies.end());
+    auto percentile = [&](double p) {
+        if (total.latencies.empty()) return 0.0;
+        return total.latencies[min(total.latencies.size() - 1, static_cast<size_t>(p * total.latencies.size()))] / 1e3;
+    };
+    cout << "Sessions: " << sessions << " over " << threads << " thread(s)\n"
+         << "Requests: " << total.requests << " (" << static_cast<long>(total.requests / elapsed) << " per second)\n"
+         << "Games finished: " << total.games << "\n"
+         << "Errors: " << total.errors << "\n"
+         << "Latency (us): p50 " << percentile(0.5) << ", p99 " << percentile(0.99) << ", p99.9 "
+         << percentile(0.999) << ", max " << percentile(1.0) << "\n";
+    return total.errors == 0 ? 0 : 1;
 }
+#endif
+
 void displayInstructions() {
     cout << "Welcome to Hangman!" << endl;
     cout << "How to play:" << endl;
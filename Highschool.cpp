@@ -3,10 +3,37 @@
 #include <string>
 #include <stdexcept> //  For exception handling (throwing and catching errors).
 #include <algorithm> // For generic algorithms (searching, sorting, etc., on containers).
+#include <array> // For fixed-size arrays (one slot per genre).
+#include <unordered_map> // For hash tables used to index books and patrons.
+#include <cstdint> // For fixed-width integer types used in journal records.
+#include <cstdio> // For sscanf/snprintf used in date conversion.
+#include <cstring> // For strerror when reporting system call failures.
+#include <cerrno> // For errno set by system calls.
+#include <fcntl.h> // For open() flags used by the journal file.
+#include <unistd.h> // For write/fsync/close on the journal file.
+#include <sys/stat.h> // For fstat to size the journal before replay.
+#include <atomic> // For lock-free checkout and fee flags.
+#include <mutex> // For patron shard locks and the journal locks.
+#include <condition_variable> // For waiting on the journal's group commit.
+#include <shared_mutex> // For shared_lock on the catalog lock shared by concurrent desks.
+#include <thread> // For the multi-desk stress test.
+#include <random> // For random workloads in the stress test.
+#include <chrono> // For timing the stress test.
+#include <memory> // For unique_ptr arrays of atomics in the stress test.
+#include <string_view> // For zero-copy field slices while importing catalogs.
+#include <charconv> // For from_chars number parsing while importing catalogs.
+#include <optional> // For lookups that may find nothing.
+#include <cctype> // For character classification when splitting text into words.
+#include <climits> // For INT32_MAX when capping owed fees.
+#include <sys/mman.h> // For memory-mapping catalog files.
+#include <deque> // For the queue of open loans in the benchmark trace.
+#include <cmath> // For pow/exp/log in the Zipf generator.
+#include <numeric> // For gcd when scattering benchmark ranks.
 using namespace std;
 
 // Enum for Genre of books
 enum class Genre { fiction, nonfiction, periodical, biography, children };
+const size_t genreCount = 5; // Number of Genre values, used to size per-genre tables
 
 // Convert Genre enum to string for display purposes
 string genreToString(Genre genre) {
@@ -20,35 +47,56 @@ string genreToString(Genre genre) {
     }
 }
 
-// Book Class: Represents a book in the library
+// Convert a genre name (any letter case) or its number to a Genre.
+// Returns false if the text names no genre.
+bool parseGenre(string_view text, Genre& genre) {
+    static const char* const names[genreCount] = { "fiction", "nonfiction", "periodical", "biography", "children" };
+    if (text.size() == 1 && text[0] >= '0' && text[0] < static_cast<char>('0' + genreCount)) {
+        genre = static_cast<Genre>(text[0] - '0');
+        return true;
+    }
+    for (size_t g = 0; g < genreCount; ++g) {
+        size_t length = strlen(names[g]);
+        if (text.size() != length) continue;
+        bool same = true;
+        for (size_t i = 0; i < length && same; ++i) {
+            same = tolower(static_cast<unsigned char>(text[i])) == names[g][i];
+        }
+        if (same) {
+            genre = static_cast<Genre>(g);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Book Class: Lightweight view of a book. The library stores books column by
+// column, and a Book only points at the interned strings, so it is cheap to
+// create and copy. A Book passed to addBook only needs its strings to stay
+// alive for that call; a Book returned by the library stays valid as long as
+// the library does.
 class Book {
 private:
-    string ISBN;          // Unique identifier for the book
-    string title;         // Title of the book
-    string author;        // Author of the book
+    string_view ISBN;     // Unique identifier for the book
+    string_view title;    // Title of the book
+    string_view author;   // Author of the book
     int copyrightDate;    // Year the book was published
-    bool checkedOut;      // Whether the book is checked out or not
+    bool checkedOut;      // Whether the book was checked out when the view was made
     Genre genre;          // Genre of the book (fiction, nonfiction, etc.)
 
 public:
     // Constructor to initialize a Book object
-    Book(string isbn, string t, string a, int date, Genre g)
-        : ISBN(isbn), title(t), author(a), copyrightDate(date), checkedOut(false), genre(g) {}
+    Book(string_view isbn, string_view t, string_view a, int date, Genre g, bool out = false)
+        : ISBN(isbn), title(t), author(a), copyrightDate(date), checkedOut(out), genre(g) {}
 
     // Getters for the Book's properties
-    string getISBN() const { return ISBN; }
-    string getTitle() const { return title; }
-    string getAuthor() const { return author; }
+    string_view getISBN() const { return ISBN; }
+    string_view getTitle() const { return title; }
+    string_view getAuthor() const { return author; }
     int getCopyrightDate() const { return copyrightDate; }
     bool isCheckedOut() const { return checkedOut; }
     Genre getGenre() const { return genre; }
 
-    // Function to check out the book (set checkedOut to true)
-    void checkOut() { checkedOut = true; }
-
-    // Function to check in the book (set checkedOut to false)
-    void checkIn() { checkedOut = false; }
-
     // Overload == operator to compare books based on ISBN
     bool operator==(const Book& other) const {
         return ISBN == other.ISBN;
@@ -69,127 +117,2665 @@ public:
     }
 };
 
-// Patron Class: Represents a library user
+// Patron Class: Lightweight view of a library user (see Book for lifetimes)
 class Patron {
 private:
-    string userName;     // Name of the patron
-    string cardNumber;   // Unique card number of the patron
-    int owedFees;        // Fees owed by the patron
+    string_view userName;   // Name of the patron
+    string_view cardNumber; // Unique card number of the patron
+    int owedFees;           // Fees owed by the patron when the view was made
 
 public:
     // Constructor to initialize a Patron object
-    Patron(string name, string card, int fees = 0)
+    Patron(string_view name, string_view card, int fees = 0)
         : userName(name), cardNumber(card), owedFees(fees) {}
 
     // Getters for Patron's properties
-    string getUserName() const { return userName; }
-    string getCardNumber() const { return cardNumber; }
+    string_view getUserName() const { return userName; }
+    string_view getCardNumber() const { return cardNumber; }
     int getOwedFees() const { return owedFees; }
 
-    // Setter for owed fees
-    void setOwedFees(int fees) { owedFees = fees; }
-
     // Function to check if the patron owes fees
     bool owesFees() const { return owedFees > 0; }
 };
 
-// Transaction Class: Represents a book check-out or check-in transaction
+// Convert a "YYYY-MM-DD" date to a day number counted from 1970-01-01
+int32_t dateToEpochDay(const string& date) {
+    int y, m, d, used = 0;
+    char dash1, dash2;
+    if (sscanf(date.c_str(), "%d%c%d%c%d%n", &y, &dash1, &m, &dash2, &d, &used) != 5 ||
+        static_cast<size_t>(used) != date.size() || dash1 != '-' || dash2 != '-' || m < 1 || m > 12 || d < 1) {
+        throw runtime_error("Invalid date: " + date);
+    }
+    // Days in the month, with February's leap day every 4 years except centuries not divisible by 400
+    static const int monthDays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (d > monthDays[m - 1] + (m == 2 && leap)) {
+        throw runtime_error("Invalid date: " + date);
+    }
+    // Civil-calendar to day-count conversion using 400-year eras
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const int yearOfEra = y - era * 400;
+    const int dayOfYear = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Convert a day number counted from 1970-01-01 back to a "YYYY-MM-DD" date
+string epochDayToDate(int32_t day) {
+    day += 719468;
+    const int era = (day >= 0 ? day : day - 146096) / 146097;
+    const int dayOfEra = day - era * 146097;
+    const int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const int mp = (5 * dayOfYear + 2) / 153;
+    const int d = dayOfYear - (153 * mp + 2) / 5 + 1;
+    const int m = mp + (mp < 10 ? 3 : -9);
+    const int y = yearOfEra + era * 400 + (m <= 2);
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", y, m, d);
+    return buffer;
+}
+
+// Enum for the outcome of checking a book out or in
+enum class CirculationStatus : uint8_t { ok, bookNotFound, patronNotFound, patronOwesFees, alreadyCheckedOut, notCheckedOut };
+
+// Convert a CirculationStatus to the message shown to library staff
+string circulationStatusToString(CirculationStatus status) {
+    switch (status) {
+        case CirculationStatus::ok: return "OK";
+        case CirculationStatus::bookNotFound: return "Book not found in library.";
+        case CirculationStatus::patronNotFound: return "Patron not found in library.";
+        case CirculationStatus::patronOwesFees: return "Patron owes fees and cannot check out books.";
+        case CirculationStatus::alreadyCheckedOut: return "Book is already checked out.";
+        case CirculationStatus::notCheckedOut: return "Book is not checked out.";
+        default: return "Unknown";
+    }
+}
+
+// Structure for the outcome of one returned book in a batch check-in
+struct CheckInResult {
+    CirculationStatus status; // Whether the return was recorded
+    int fine;                 // Late fine charged (0 unless status is ok)
+};
+
+// Enum for the kind of activity a transaction records
+enum class Activity : uint8_t { checkOut, checkIn, checkpoint, setFees };
+
+// Transaction Class: Represents a book check-out or check-in transaction.
+// It is a fixed-size record that refers to the book and patron by their slot
+// in the library, so it can be written to and read from the journal as is.
 class Transaction {
 private:
-    Book book;           // The book involved in the transaction
-    Patron patron;       // The patron involved in the transaction
-    string activity;     // Activity: "Check Out" or "Check In"
-    string date;         // Date of the transaction
+    uint32_t bookId;     // Slot of the book in the library
+    uint32_t patronId;   // Slot of the patron in the library
+    int32_t day;         // Date of the transaction as a day number (the amount for setFees)
+    Activity activity;   // Check out, check in, checkpoint marker or fee change
+    uint8_t padding[3] = {}; // Keeps the on-disk record free of uninitialized bytes
 
 public:
     // Constructor to initialize a Transaction object
-    Transaction(const Book& b, const Patron& p, string act, string d)
-        : book(b), patron(p), activity(act), date(d) {}
+    Transaction(uint32_t book = 0, uint32_t patron = 0, Activity act = Activity::checkOut, int32_t d = 0)
+        : bookId(book), patronId(patron), day(d), activity(act) {}
+
+    // Getters for the Transaction's properties
+    uint32_t getBookId() const { return bookId; }
+    uint32_t getPatronId() const { return patronId; }
+    int32_t getDay() const { return day; }
+    Activity getActivity() const { return activity; }
 
     // Display transaction details (overloaded ostream operator)
     friend ostream& operator<<(ostream& os, const Transaction& transaction) {
+        static const char* const activityNames[] = { "Check Out", "Check In", "Checkpoint", "Set Fees" };
         os << "Transaction Details:\n"
-           << transaction.book
-           << "Patron: " << transaction.patron.getUserName() << "\n"
-           << "Activity: " << transaction.activity << "\n"
-           << "Date: " << transaction.date << "\n";
+           << "Book: #" << transaction.bookId << "\n"
+           << "Patron: #" << transaction.patronId << "\n"
+           << "Activity: " << activityNames[static_cast<int>(transaction.activity)] << "\n";
+        if (transaction.activity == Activity::setFees) {
+            os << "Amount: " << transaction.day << "\n";
+        } else {
+            os << "Date: " << epochDayToDate(transaction.day) << "\n";
+        }
         return os;
     }
 };
+static_assert(sizeof(Transaction) == 16, "Transaction must stay a fixed 16-byte journal record");
 
-// Library Class: Represents the library that manages books and patrons
-class Library {
+// Function to write a whole buffer to a file, retrying on short writes
+void writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw runtime_error("Failed to write file: " + string(strerror(errno)));
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+// Journal Class: Append-only file of Transaction records, with group commit.
+// append queues records and returns a ticket; waitDurable(ticket) returns
+// once they are on disk. Appending takes no lock: a thread reserves
+// sequence numbers with one fetch_add, copies its records into a ring
+// buffer and publishes each slot. The first waiter to find no write in
+// progress writes every published record and fdatasyncs it, while later
+// appends queue up for the next round, so a burst of checkouts shares one
+// disk flush. A transaction is acknowledged only after waitDurable, so a
+// crash loses nothing that was acknowledged. append, waitDurable and
+// commit may be called from several threads at once.
+class Journal {
 private:
-    vector<Book> books;        // List of books in the library
-    vector<Patron> patrons;    // List of patrons in the library
-    vector<Transaction> transactions; // List of transactions (checkouts/checkins)
+    static constexpr size_t ringSize = 4096; // Records that can wait to be written
+
+    int fd = -1;                  // File descriptor of the open journal
+    string path;                  // Location of the journal file
+    unique_ptr<Transaction[]> ring;              // Record with sequence number n sits in slot n % ringSize
+    unique_ptr<atomic<uint64_t>[]> published;    // n + 1 once record n is in its slot
+    atomic<uint64_t> reserved{0}; // Sequence numbers handed out (the latest ticket)
+    atomic<uint64_t> durable{0};  // Records known to be on disk
+    uint64_t nextWrite = 0;       // First record not yet written (used by the writer only)
+    bool writing = false;         // Whether a waiter is writing a batch right now
+    string failure;               // Why the last write failed (the queued records are lost)
+    mutex writerMutex;            // Guards writing and failure, for waiters only
+    condition_variable written;   // Signalled when a batch is on disk
 
 public:
-    // Function to add a book to the library
-    void addBook(const Book& book) {
-        books.push_back(book);
+    Journal() : ring(new Transaction[ringSize]), published(new atomic<uint64_t>[ringSize]) {
+        for (size_t i = 0; i < ringSize; ++i) published[i].store(0, memory_order_relaxed);
     }
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
 
-    // Function to add a patron to the library
-    void addPatron(const Patron& patron) {
-        patrons.push_back(patron);
+    // Destructor commits whatever is still buffered
+    ~Journal() {
+        try {
+            close();
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+        }
     }
 
-    // Function to check out a book
-    void checkOutBook(const string& isbn, const string& cardNumber, const string& date) {
-        // Find the book by ISBN
-        auto bookIt = find_if(books.begin(), books.end(), [&](const Book& book) { return book.getISBN() == isbn; });
-        if (bookIt == books.end()) {
-            throw runtime_error("Book not found in library.");
+    bool isOpen() const { return fd >= 0; }
+
+    // Function to open (or create) the journal for appending
+    void open(const string& journalPath) {
+        close();
+        fd = ::open(journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw runtime_error("Cannot open journal " + journalPath + ": " + strerror(errno));
         }
-        // Check if the book is already checked out
-        if (bookIt->isCheckedOut()) {
-            throw runtime_error("Book is already checked out.");
+        path = journalPath;
+    }
+
+    // Function to commit buffered records and close the file
+    void close() {
+        if (fd < 0) return;
+        commit();
+        ::close(fd);
+        fd = -1;
+    }
+
+    // Function to queue a record; returns the ticket to wait on
+    uint64_t append(const Transaction& transaction) {
+        return append(&transaction, 1);
+    }
+
+    // Function to queue several records at once. Call it while holding the
+    // locks that ordered the changes, so records reach the file in the order
+    // they happened. Returns 0 if there is no journal.
+    uint64_t append(const Transaction* transactions, size_t count) {
+        if (fd < 0 || count == 0) return 0; // No journal attached
+        uint64_t ticket = 0;
+        while (count > 0) {
+            size_t piece = min(count, ringSize);
+            uint64_t first = reserved.fetch_add(piece, memory_order_relaxed);
+            ticket = first + piece;
+            // A full ring must be written out before its slots are reused
+            if (ticket > durable.load(memory_order_acquire) + ringSize) waitDurable(ticket - ringSize);
+            for (size_t i = 0; i < piece; ++i) {
+                size_t slot = static_cast<size_t>((first + i) % ringSize);
+                ring[slot] = transactions[i];
+                published[slot].store(first + i + 1, memory_order_release);
+            }
+            transactions += piece;
+            count -= piece;
         }
+        return ticket;
+    }
 
-        // Find the patron by card number
-        auto patronIt = find_if(patrons.begin(), patrons.end(), [&](const Patron& patron) { return patron.getCardNumber() == cardNumber; });
-        if (patronIt == patrons.end()) {
-            throw runtime_error("Patron not found in library.");
+    // Function to wait until the records up to a ticket are on disk, writing
+    // them (and everything published with them) if no other thread is. Call
+    // it after releasing other locks, since it may wait for an fdatasync.
+    void waitDurable(uint64_t ticket) {
+        if (ticket == 0 || durable.load(memory_order_acquire) >= ticket) return;
+        unique_lock<mutex> lock(writerMutex);
+        while (durable.load(memory_order_acquire) < ticket) {
+            if (!failure.empty()) throw runtime_error(failure);
+            if (writing) {
+                written.wait(lock);
+                continue;
+            }
+            writing = true;
+            lock.unlock();
+            string error = writePublished();
+            lock.lock();
+            writing = false;
+            if (!error.empty()) failure = error;
+            written.notify_all();
+        }
+    }
+
+    // Function to write all queued records and flush them to disk
+    void commit() {
+        waitDurable(reserved.load(memory_order_acquire));
+    }
+
+private:
+    // Function to write the published records after the last write, as far as
+    // the first slot still being filled, and fdatasync them. Run by one
+    // waiter at a time. Returns an error message, or an empty string.
+    string writePublished() {
+        uint64_t end = nextWrite;
+        uint64_t limit = reserved.load(memory_order_acquire);
+        while (end < limit && published[end % ringSize].load(memory_order_acquire) == end + 1) ++end;
+        if (end == nextWrite) { // The next record is reserved but not copied in yet
+            this_thread::yield();
+            return "";
         }
-        // Check if the patron owes fees
-        if (patronIt->owesFees()) {
-            throw runtime_error("Patron owes fees and cannot check out books.");
+        try {
+            size_t first = static_cast<size_t>(nextWrite % ringSize);
+            size_t count = static_cast<size_t>(end - nextWrite);
+            size_t untilWrap = min(count, ringSize - first);
+            writeAll(fd, &ring[first], untilWrap * sizeof(Transaction));
+            writeAll(fd, &ring[0], (count - untilWrap) * sizeof(Transaction));
+        } catch (const exception& e) {
+            return e.what();
         }
+        if (::fdatasync(fd) != 0) return "Failed to sync journal: " + string(strerror(errno));
+        nextWrite = end;
+        durable.store(end, memory_order_release);
+        return "";
+    }
 
-        // Perform the checkout: mark book as checked out and record the transaction
-        bookIt->checkOut();
-        transactions.emplace_back(*bookIt, *patronIt, "Check Out", date);
+public:
+    // Function to atomically replace the journal with a checkpoint marker
+    // followed by the given records (the state to rebuild from). The marker
+    // carries the id of the snapshot the records apply on top of (0 for none)
+    // in its book and patron fields.
+    void rewrite(int32_t day, const vector<Transaction>& records, uint64_t snapshotId) {
+        string tmpPath = path + ".tmp";
+        int tmp = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (tmp < 0) {
+            throw runtime_error("Cannot create " + tmpPath + ": " + strerror(errno));
+        }
+        Transaction marker(static_cast<uint32_t>(snapshotId), static_cast<uint32_t>(snapshotId >> 32),
+                           Activity::checkpoint, day);
+        writeAll(tmp, &marker, sizeof(marker));
+        writeAll(tmp, records.data(), records.size() * sizeof(Transaction));
+        if (::fsync(tmp) != 0 || ::close(tmp) != 0 || ::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            throw runtime_error("Failed to write checkpoint: " + string(strerror(errno)));
+        }
+        // Reopen so later appends go to the new file (everything queued was committed first)
+        open(path);
     }
 
-    // Function to return a list of patrons who owe fees
-    vector<string> patronsOwingFees() const {
-        vector<string> owingPatrons;
-        for (const auto& patron : patrons) {
-            if (patron.owesFees()) {
-                owingPatrons.push_back(patron.getUserName());
+    // Function to read the records written since the last checkpoint marker
+    // and the snapshot id and clock day that marker carries (0 if there is no
+    // marker). A torn record at the end (from a crash mid-write) is ignored.
+    static vector<Transaction> readSinceCheckpoint(const string& journalPath, uint64_t& snapshotId,
+                                                   int32_t& checkpointDay) {
+        snapshotId = 0;
+        checkpointDay = 0;
+        vector<Transaction> records;
+        int in = ::open(journalPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) {
+            if (errno == ENOENT) return records; // No journal yet: nothing to replay
+            throw runtime_error("Cannot read journal " + journalPath + ": " + strerror(errno));
+        }
+        struct stat info;
+        if (::fstat(in, &info) != 0) {
+            ::close(in);
+            throw runtime_error("Cannot stat journal " + journalPath + ": " + strerror(errno));
+        }
+        records.resize(static_cast<size_t>(info.st_size) / sizeof(Transaction));
+        size_t wanted = records.size() * sizeof(Transaction);
+        char* bytes = reinterpret_cast<char*>(records.data());
+        size_t got = 0;
+        while (got < wanted) {
+            ssize_t n = ::pread(in, bytes + got, wanted - got, static_cast<off_t>(got));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            got += static_cast<size_t>(n);
+        }
+        ::close(in);
+        records.resize(got / sizeof(Transaction));
+
+        // Drop everything before (and including) the last checkpoint marker
+        for (size_t i = records.size(); i-- > 0;) {
+            if (records[i].getActivity() == Activity::checkpoint) {
+                snapshotId = records[i].getBookId() | static_cast<uint64_t>(records[i].getPatronId()) << 32;
+                checkpointDay = records[i].getDay();
+                records.erase(records.begin(), records.begin() + static_cast<ptrdiff_t>(i) + 1);
+                break;
             }
         }
-        return owingPatrons;
+        return records;
     }
 };
 
-// Main function where the program starts
-int main() {
-    try {
-        // Create a library instance
-        Library library;
+// FileMapping Class: Private memory map of a whole file, read-only unless
+// the caller asks for copy-on-write pages it may scribble on
+class FileMapping {
+private:
+    const char* data = nullptr; // Start of the mapped bytes
+    size_t length = 0;          // Size of the file
 
-        // Add books to the library
-        library.addBook(Book("123", "C++ Primer", "Stanley Lippman", 2012, Genre::nonfiction));
-        library.addBook(Book("456", "The Great Gatsby", "F. Scott Fitzgerald", 1925, Genre::fiction));
+public:
+    // Constructor maps the file, telling the kernel whether it will be read
+    // front to back (imports) or at random (snapshots). A writable mapping is
+    // copy-on-write, so changes never reach the file.
+    explicit FileMapping(const string& path, bool sequential = true, bool writable = false) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw runtime_error("Cannot open " + path + ": " + strerror(errno));
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw runtime_error("Cannot stat " + path + ": " + strerror(errno));
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* mapped = ::mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                                  MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw runtime_error("Cannot map " + path + ": " + strerror(errno));
+            }
+            ::madvise(mapped, length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+            data = static_cast<const char*>(mapped);
+        }
+        ::close(fd); // The mapping stays valid after the descriptor is closed
+    }
 
-        // Add patrons to the library
-        library.addPatron(Patron("Alice", "001"));
-        library.addPatron(Patron("Bob", "002", 10)); // Bob owes fees
+    FileMapping(const FileMapping&) = delete;
+    FileMapping& operator=(const FileMapping&) = delete;
 
-        // Attempt to check out a book (Alice checks out "C++ Primer")
-        library.checkOutBook("123", "001", "2024-11-25");
+    ~FileMapping() {
+        if (data != nullptr) ::munmap(const_cast<char*>(data), length);
+    }
+
+    string_view view() const { return string_view(data, length); }
+};
+
+// Function to split delimited text into the records of roughly equal chunks.
+// Chunk boundaries always fall just after a newline that is outside quotes:
+// an odd number of '"' since the chunk began means a quoted field is open
+// (a doubled "" inside it counts twice and so leaves the parity alone).
+vector<string_view> splitIntoChunks(string_view text, size_t chunkCount) {
+    vector<string_view> chunks;
+    size_t begin = 0;
+    for (size_t c = 1; c <= chunkCount && begin < text.size(); ++c) {
+        size_t end = c == chunkCount ? text.size() : max(begin, text.size() * c / chunkCount);
+        bool quoted = count(text.begin() + begin, text.begin() + end, '"') % 2 != 0;
+        while (end < text.size()) {
+            size_t newline = text.find('\n', end);
+            if (newline == string_view::npos) {
+                end = text.size();
+                break;
+            }
+            quoted ^= count(text.begin() + end, text.begin() + newline, '"') % 2 != 0;
+            end = newline + 1;
+            if (!quoted) break;
+        }
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+    return chunks;
+}
+
+// Function to call handleFields(fields, count) for every non-empty record of
+// a chunk, with the record cut at the delimiter into string_view slices.
+// Fields follow RFC 4180: a field wrapped in double quotes may hold the
+// delimiter, newlines and "" for a literal quote. Doubled quotes are
+// collapsed in place, so the chunk must lie in writable memory (such as a
+// copy-on-write FileMapping); chunks without them are never written to.
+template <size_t MaxFields, typename Handler>
+void forEachRecord(string_view chunk, char delimiter, Handler handleFields) {
+    array<string_view, MaxFields> fields;
+    char* cursor = const_cast<char*>(chunk.data());
+    char* const end = cursor + chunk.size();
+    while (cursor < end) {
+        if (*cursor == '\n') {
+            ++cursor;
+            continue;
+        }
+        if (*cursor == '\r' && (cursor + 1 == end || cursor[1] == '\n')) {
+            cursor += cursor + 1 == end ? 1 : 2;
+            continue;
+        }
+
+        size_t count = 0;
+        bool recordEnd = false;
+        while (!recordEnd) {
+            char* fieldBegin;
+            char* fieldEnd;
+            if (cursor < end && *cursor == '"') {
+                fieldBegin = fieldEnd = ++cursor;
+                while (true) {
+                    if (cursor == end) throw runtime_error("Unterminated quoted field in delimited text.");
+                    if (*cursor == '"') {
+                        if (cursor + 1 == end || cursor[1] != '"') break;
+                        ++cursor; // Keep the second quote of the pair
+                    }
+                    if (fieldEnd != cursor) *fieldEnd = *cursor;
+                    ++fieldEnd;
+                    ++cursor;
+                }
+                ++cursor; // Closing quote
+                if (cursor < end && *cursor == '\r' && (cursor + 1 == end || cursor[1] == '\n')) ++cursor;
+                if (cursor < end && *cursor != delimiter && *cursor != '\n') {
+                    throw runtime_error("Unexpected text after a quoted field in delimited text.");
+                }
+            } else {
+                fieldBegin = cursor;
+                while (cursor < end && *cursor != delimiter && *cursor != '\n') ++cursor;
+                fieldEnd = cursor;
+                if (fieldEnd > fieldBegin && fieldEnd[-1] == '\r' && (cursor == end || *cursor == '\n')) --fieldEnd;
+            }
+            if (count < MaxFields) fields[count] = string_view(fieldBegin, static_cast<size_t>(fieldEnd - fieldBegin));
+            ++count;
+            recordEnd = cursor == end || *cursor == '\n';
+            if (cursor < end) ++cursor; // Delimiter or newline
+        }
+        handleFields(fields, count);
+    }
+}
+
+// Function to parse a whole field as an integer; trailing text such as the
+// "abc" of "1999abc" makes the field malformed
+bool parseInteger(string_view field, int& value) {
+    auto result = from_chars(field.data(), field.data() + field.size(), value);
+    return result.ec == errc() && result.ptr == field.data() + field.size();
+}
+
+// Function to work out the delimiter (tab for TSV, otherwise comma) and to
+// drop a header line whose first field is the given column name
+string_view prepareDelimitedText(string_view text, const char* firstColumn, char& delimiter) {
+    string_view firstLine = text.substr(0, text.find('\n'));
+    delimiter = firstLine.find('\t') != string_view::npos ? '\t' : ',';
+    string_view firstField = firstLine.substr(0, firstLine.find(delimiter));
+    if (firstField.size() == strlen(firstColumn)) {
+        bool header = true;
+        for (size_t i = 0; i < firstField.size() && header; ++i) {
+            header = tolower(static_cast<unsigned char>(firstField[i])) == firstColumn[i];
+        }
+        if (header) text.remove_prefix(min(text.size(), firstLine.size() + 1));
+    }
+    return text;
+}
+
+// Function to parse the records of every chunk on its own thread (or inline
+// for a single chunk). parseChunk(chunk, out) fills one result vector per chunk.
+template <typename Record, typename Parser>
+vector<vector<Record>> parseChunksInParallel(const vector<string_view>& chunks, Parser parseChunk) {
+    vector<vector<Record>> results(chunks.size());
+    vector<exception_ptr> errors(chunks.size());
+    auto work = [&](size_t c) {
+        try {
+            parseChunk(chunks[c], results[c]);
+        } catch (...) {
+            errors[c] = current_exception();
+        }
+    };
+    if (chunks.size() == 1) {
+        work(0);
+    } else {
+        vector<thread> workers;
+        for (size_t c = 0; c < chunks.size(); ++c) workers.emplace_back(work, c);
+        for (auto& worker : workers) worker.join();
+    }
+    for (auto& error : errors) {
+        if (error) rethrow_exception(error);
+    }
+    return results;
+}
+
+// Function to hash bytes with 64-bit FNV-1a. Unlike std::hash its result is
+// fixed, so tables built with it can be saved in a snapshot and reused.
+uint64_t hashString(string_view text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : text) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Function to checksum a block of bytes a word at a time
+uint64_t checksumBytes(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t sum = 0x9e3779b97f4a7c15ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        sum = (sum ^ word) * 0xff51afd7ed558ccdull;
+        sum ^= sum >> 32;
+    }
+    for (; i < size; ++i) {
+        sum = (sum ^ bytes[i]) * 0xc4ceb9fe1a85ec53ull;
+    }
+    return sum ^ (sum >> 29);
+}
+
+// Column Class: Array that either owns its elements or views elements that
+// live in a read-only snapshot mapping. A viewing column is copied into its
+// own storage the first time it is changed (copy-on-write), so loading a
+// snapshot costs nothing per element. Changes must be made under the
+// library's exclusive catalog lock.
+template <typename T>
+class Column {
+private:
+    vector<T> owned;            // Elements once the column owns them
+    const T* mapped = nullptr;  // Elements in the snapshot while still viewing it
+    size_t mappedCount = 0;     // Number of viewed elements
+
+    // Function to take a private copy of the viewed elements
+    void own() {
+        if (mapped == nullptr) return;
+        owned.assign(mapped, mapped + mappedCount);
+        mapped = nullptr;
+        mappedCount = 0;
+    }
+
+public:
+    size_t size() const { return mapped != nullptr ? mappedCount : owned.size(); }
+    const T* data() const { return mapped != nullptr ? mapped : owned.data(); }
+    const T& operator[](size_t index) const { return data()[index]; }
+
+    // Function to view elements stored in a snapshot mapping
+    void view(const T* elements, size_t count) {
+        vector<T>().swap(owned);
+        mapped = elements;
+        mappedCount = count;
+    }
+
+    void push_back(const T& value) { own(); owned.push_back(value); }
+    void reserve(size_t count) { own(); owned.reserve(count); }
+    void resize(size_t count, const T& fill = T()) { own(); owned.resize(count, fill); }
+    T& at(size_t index) { own(); return owned[index]; }
+};
+
+// FlatIndex Class: Open-addressing hash table from a string key to a 32-bit
+// value. It only stores the values; the key of a value is recovered through
+// a keyOf(value) function given by the caller (for example the ISBN of a
+// book slot), which keeps the table a plain array of integers that can be
+// saved in a snapshot and mapped back in.
+class FlatIndex {
+private:
+    Column<uint32_t> slots; // value + 1 in each used slot, 0 in empty slots
+    size_t used = 0;        // Number of values stored
+
+    size_t mask() const { return slots.size() - 1; }
+
+    // Function to find the slot holding key, or the empty slot where it would go
+    template <typename KeyOf>
+    size_t probe(string_view key, KeyOf keyOf) const {
+        size_t i = static_cast<size_t>(hashString(key)) & mask();
+        while (slots[i] != 0 && keyOf(slots[i] - 1) != key) i = (i + 1) & mask();
+        return i;
+    }
+
+    // Function to rebuild the table with a new capacity (a power of two)
+    template <typename KeyOf>
+    void rehash(size_t capacity, KeyOf keyOf) {
+        vector<uint32_t> old(slots.data(), slots.data() + slots.size());
+        slots = Column<uint32_t>();
+        slots.resize(capacity, 0);
+        for (size_t i = 0; i < old.size(); ++i) {
+            if (old[i] != 0) slots.at(probe(keyOf(old[i] - 1), keyOf)) = old[i];
+        }
+    }
+
+public:
+    size_t size() const { return used; }
+    size_t capacity() const { return slots.size(); }
+    const uint32_t* data() const { return slots.data(); }
+
+    // Function to view a table saved in a snapshot
+    void view(const uint32_t* savedSlots, size_t capacity, size_t count) {
+        slots.view(savedSlots, capacity);
+        used = count;
+    }
+
+    // Function to look up the value stored for a key (returns false if absent)
+    template <typename KeyOf>
+    bool find(string_view key, KeyOf keyOf, uint32_t& value) const {
+        if (used == 0) return false;
+        size_t i = probe(key, keyOf);
+        if (slots[i] == 0) return false;
+        value = slots[i] - 1;
+        return true;
+    }
+
+    // Function to store a value under its key; returns false (storing
+    // nothing) if the key is already present
+    template <typename KeyOf>
+    bool insert(uint32_t value, KeyOf keyOf) {
+        reserve(used + 1, keyOf);
+        size_t i = probe(keyOf(value), keyOf);
+        if (slots[i] != 0) return false;
+        slots.at(i) = value + 1;
+        ++used;
+        return true;
+    }
+
+    // Function to remove a key, shifting later entries of its probe run back
+    // so lookups never stop early at the hole
+    template <typename KeyOf>
+    void erase(string_view key, KeyOf keyOf) {
+        if (used == 0) return;
+        size_t hole = probe(key, keyOf);
+        if (slots[hole] == 0) return;
+        slots.at(hole) = 0;
+        --used;
+        for (size_t i = (hole + 1) & mask(); slots[i] != 0; i = (i + 1) & mask()) {
+            size_t home = static_cast<size_t>(hashString(keyOf(slots[i] - 1))) & mask();
+            // Move the entry into the hole unless its home lies between the hole and it
+            if (((i - home) & mask()) >= ((i - hole) & mask())) {
+                slots.at(hole) = slots[i];
+                slots.at(i) = 0;
+                hole = i;
+            }
+        }
+    }
+
+    // Function to make room for a number of values, keeping the table at
+    // most half full
+    template <typename KeyOf>
+    void reserve(size_t count, KeyOf keyOf) {
+        if (count * 2 <= slots.size()) return;
+        size_t capacity = max<size_t>(slots.size(), 16);
+        while (capacity < count * 2) capacity *= 2;
+        rehash(capacity, keyOf);
+    }
+};
+
+// StringPool Class: Stores strings in large blocks and hands out small
+// integer ids for them; interned strings are stored once. Blocks are never
+// moved or freed, so the views it returns stay valid for the pool's
+// lifetime. A pool can also view the strings of a snapshot in place.
+class StringPool {
+public:
+    // Where a string lives: a block and a position in it
+    struct Span {
+        uint64_t offset;
+        uint32_t length;
+        uint32_t block;
+    };
+
+private:
+    static constexpr size_t blockSize = 1 << 16;  // Bytes per storage block
+    vector<unique_ptr<char[]>> ownedBlocks;       // Blocks allocated by the pool
+    vector<const char*> blocks;                   // Block number -> first byte (owned or mapped)
+    size_t blockUsed = blockSize;                 // Bytes used in the last block
+    Column<Span> spans;                           // Id -> where the string is stored
+    FlatIndex ids;                                // Interned strings -> id
+
+    auto keyOf() const {
+        return [this](uint32_t id) { return get(id); };
+    }
+
+    // Function to copy text into block storage and return where it went
+    Span store(string_view text) {
+        if (text.size() > blockSize / 4) {
+            // Large strings get a block of their own; the next small string starts a fresh block
+            ownedBlocks.emplace_back(new char[text.size()]);
+            blocks.push_back(ownedBlocks.back().get());
+            blockUsed = blockSize;
+            memcpy(ownedBlocks.back().get(), text.data(), text.size());
+            return { 0, static_cast<uint32_t>(text.size()), static_cast<uint32_t>(blocks.size() - 1) };
+        }
+        if (blockUsed + text.size() > blockSize) {
+            ownedBlocks.emplace_back(new char[blockSize]);
+            blocks.push_back(ownedBlocks.back().get());
+            blockUsed = 0;
+        }
+        memcpy(ownedBlocks.back().get() + blockUsed, text.data(), text.size());
+        Span span = { blockUsed, static_cast<uint32_t>(text.size()), static_cast<uint32_t>(blocks.size() - 1) };
+        blockUsed += text.size();
+        return span;
+    }
+
+public:
+    size_t size() const { return spans.size(); }
+
+    // Function to store a string that is known to be unique (ISBNs, card numbers)
+    uint32_t add(string_view text) {
+        spans.push_back(store(text));
+        return static_cast<uint32_t>(spans.size() - 1);
+    }
+
+    // Function to return the id of a string, storing it the first time it is seen
+    uint32_t intern(string_view text) {
+        uint32_t id;
+        if (ids.find(text, keyOf(), id)) return id;
+        id = add(text);
+        ids.insert(id, keyOf());
+        return id;
+    }
+
+    // Function to look up the id of an interned string (returns false if never interned)
+    bool find(string_view text, uint32_t& id) const {
+        return ids.find(text, keyOf(), id);
+    }
+
+    string_view get(uint32_t id) const {
+        const Span& span = spans[id];
+        return string_view(blocks[span.block] + span.offset, span.length);
+    }
+
+    // Function to make room for more strings without rehashing along the way
+    void reserve(size_t extra) {
+        spans.reserve(spans.size() + extra);
+        ids.reserve(ids.size() + extra, keyOf());
+    }
+
+    // Functions used to save the pool in a snapshot and view it again
+    const FlatIndex& internTable() const { return ids; }
+    void view(const char* bytes, const Span* savedSpans, size_t count,
+              const uint32_t* internSlots, size_t internCapacity, size_t internCount) {
+        blocks.assign(1, bytes); // Block 0 is the snapshot's string bytes
+        blockUsed = blockSize;   // New strings go to fresh owned blocks
+        spans.view(savedSpans, count);
+        ids.view(internSlots, internCapacity, internCount);
+    }
+};
+
+// TextIndex Class: Inverted index over the words of book titles and authors.
+// Words are lowercased runs of letters and digits. Each distinct word keeps
+// one posting list (book slots in catalog order) for titles and one for
+// authors, and a trigram index over the vocabulary finds the words that
+// contain a partial query fragment without scanning every book.
+class TextIndex {
+private:
+    StringPool words;                         // Vocabulary: word id -> word
+    vector<vector<uint32_t>> titlePostings;   // Word id -> slots of books with it in the title
+    vector<vector<uint32_t>> authorPostings;  // Word id -> slots of books with it in the author
+    unordered_map<uint32_t, vector<uint32_t>> trigrams; // Packed trigram -> word ids containing it
+
+    // Scores for one query term matching one field of a book
+    static constexpr uint32_t exactTitleScore = 4, exactAuthorScore = 3;
+    static constexpr uint32_t partialTitleScore = 2, partialAuthorScore = 1;
+
+    // A posting list together with the score each of its books earns
+    struct ScoredList {
+        const vector<uint32_t>* slots;
+        uint32_t score;
+    };
+    using Hits = vector<pair<uint32_t, uint32_t>>; // (slot, score), sorted by slot
+
+    static uint32_t packTrigram(const char* text) {
+        return static_cast<uint32_t>(static_cast<unsigned char>(text[0])) << 16 |
+               static_cast<uint32_t>(static_cast<unsigned char>(text[1])) << 8 |
+               static_cast<uint32_t>(static_cast<unsigned char>(text[2]));
+    }
+
+    // Function to add one posting, creating the word (and its trigrams) if it is new
+    void addWord(string_view word, uint32_t slot, vector<vector<uint32_t>>& postings) {
+        uint32_t id;
+        if (!words.find(word, id)) {
+            id = words.intern(word);
+            titlePostings.emplace_back();
+            authorPostings.emplace_back();
+            word = words.get(id);
+            for (size_t i = 0; i + 3 <= word.size(); ++i) {
+                vector<uint32_t>& list = trigrams[packTrigram(word.data() + i)];
+                if (list.empty() || list.back() != id) list.push_back(id); // Skip repeats within the word
+            }
+        }
+        vector<uint32_t>& list = postings[id];
+        if (list.empty() || list.back() != slot) list.push_back(slot); // Skip repeats within the field
+    }
+
+    // Function to collect the posting lists a query term matches: the word
+    // itself, plus (for terms of three or more characters) every word that
+    // contains it, found through the term's rarest trigram
+    vector<ScoredList> listsForTerm(const string& term) const {
+        vector<ScoredList> lists;
+        uint32_t exactId = UINT32_MAX;
+        if (words.find(term, exactId)) {
+            lists.push_back({ &titlePostings[exactId], exactTitleScore });
+            lists.push_back({ &authorPostings[exactId], exactAuthorScore });
+        }
+        if (term.size() >= 3) {
+            const vector<uint32_t>* rarest = nullptr;
+            for (size_t i = 0; i + 3 <= term.size(); ++i) {
+                auto it = trigrams.find(packTrigram(term.data() + i));
+                if (it == trigrams.end()) return lists; // Some trigram never occurs: no fragment matches
+                if (rarest == nullptr || it->second.size() < rarest->size()) rarest = &it->second;
+            }
+            for (uint32_t id : *rarest) {
+                if (id == exactId || words.get(id).find(term) == string_view::npos) continue;
+                lists.push_back({ &titlePostings[id], partialTitleScore });
+                lists.push_back({ &authorPostings[id], partialAuthorScore });
+            }
+        }
+        lists.erase(remove_if(lists.begin(), lists.end(), [](const ScoredList& l) { return l.slots->empty(); }),
+                    lists.end());
+        return lists;
+    }
+
+    // Function to turn (slot, score) pairs into one entry per book holding
+    // the best score, sorted by slot
+    static void keepBestPerSlot(Hits& hits) {
+        sort(hits.begin(), hits.end(), [](const auto& a, const auto& b) {
+            return a.first != b.first ? a.first < b.first : a.second > b.second;
+        });
+        hits.erase(unique(hits.begin(), hits.end(), [](const auto& a, const auto& b) { return a.first == b.first; }),
+                   hits.end());
+    }
+
+    // Function to expand lists into hits; with a limit, only the first limit
+    // slots of each list are taken
+    static Hits expand(const vector<ScoredList>& lists, size_t limit = SIZE_MAX) {
+        Hits hits;
+        for (const ScoredList& list : lists) {
+            size_t count = min(limit, list.slots->size());
+            for (size_t i = 0; i < count; ++i) hits.emplace_back((*list.slots)[i], list.score);
+        }
+        keepBestPerSlot(hits);
+        return hits;
+    }
+
+public:
+    // Function to split text into lowercase words and call handleWord on each
+    template <typename Handler>
+    static void forEachWord(string_view text, Handler handleWord) {
+        string word;
+        for (size_t i = 0; i <= text.size(); ++i) {
+            unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+            if (isalnum(c) || c >= 0x80) {
+                word.push_back(static_cast<char>(tolower(c)));
+            } else if (!word.empty()) {
+                handleWord(word);
+                word.clear();
+            }
+        }
+    }
+
+    // Function to index the title and author of the book in a slot
+    void addBook(uint32_t slot, string_view title, string_view author) {
+        forEachWord(title, [&](const string& word) { addWord(word, slot, titlePostings); });
+        forEachWord(author, [&](const string& word) { addWord(word, slot, authorPostings); });
+    }
+
+    // Function to return the slots of the best matching books, best first.
+    // A book must match every query word, as a whole word or a fragment; each
+    // word adds its best score for the book (whole word in the title, whole
+    // word in the author, fragment in the title, fragment in the author).
+    // Books with equal scores keep catalog order.
+    vector<uint32_t> search(string_view query, size_t limit) const {
+        vector<vector<ScoredList>> terms;
+        forEachWord(query, [&](const string& term) { terms.push_back(listsForTerm(term)); });
+        if (terms.empty() || limit == 0) return {};
+
+        auto totalSize = [](const vector<ScoredList>& lists) {
+            size_t total = 0;
+            for (const ScoredList& list : lists) total += list.slots->size();
+            return total;
+        };
+        // Rarest terms first, so the candidate set starts (and stays) small
+        sort(terms.begin(), terms.end(), [&](const auto& a, const auto& b) { return totalSize(a) < totalSize(b); });
+
+        Hits scores;
+        if (terms.size() == 1) {
+            // Every book in a list scores the same and ties go to the lower slot,
+            // so no book past the first limit entries of its best list can make the cut
+            scores = expand(terms[0], limit);
+        } else {
+            scores = expand(terms[0]);
+            for (size_t t = 1; t < terms.size() && !scores.empty(); ++t) {
+                Hits kept;
+                if (totalSize(terms[t]) <= 4 * scores.size()) {
+                    // Small enough to expand and intersect in one merge pass
+                    Hits hits = expand(terms[t]);
+                    size_t h = 0;
+                    for (const auto& entry : scores) {
+                        while (h < hits.size() && hits[h].first < entry.first) ++h;
+                        if (h < hits.size() && hits[h].first == entry.first) {
+                            kept.emplace_back(entry.first, entry.second + hits[h].second);
+                        }
+                    }
+                } else {
+                    // Common term: probe its lists for each remaining candidate
+                    for (const auto& entry : scores) {
+                        uint32_t best = 0;
+                        for (const ScoredList& list : terms[t]) {
+                            if (list.score > best && binary_search(list.slots->begin(), list.slots->end(), entry.first)) {
+                                best = list.score;
+                            }
+                        }
+                        if (best > 0) kept.emplace_back(entry.first, entry.second + best);
+                    }
+                }
+                scores.swap(kept);
+            }
+        }
+
+        auto better = [](const auto& a, const auto& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        };
+        size_t count = min(limit, scores.size());
+        partial_sort(scores.begin(), scores.begin() + static_cast<ptrdiff_t>(count), scores.end(), better);
+        vector<uint32_t> slots(count);
+        for (size_t i = 0; i < count; ++i) slots[i] = scores[i].first;
+        return slots;
+    }
+};
+
+// AtomicBitset Class: Packed array of flags that many threads can set and
+// clear at once. Growing it is not thread-safe and must be done while no
+// other thread uses the bitset.
+class AtomicBitset {
+private:
+    unique_ptr<atomic<uint64_t>[]> words; // 64 flags per word
+    size_t bitCount = 0;                  // Number of flags in use
+    size_t wordCapacity = 0;              // Number of words allocated
+
+public:
+    size_t size() const { return bitCount; }
+    size_t wordCount() const { return (bitCount + 63) / 64; }
+
+    // Function to grow (or shrink) to the given number of flags; new flags are clear
+    void resize(size_t bits) {
+        size_t needed = (bits + 63) / 64;
+        if (needed > wordCapacity) {
+            size_t capacity = max(needed, wordCapacity * 2);
+            unique_ptr<atomic<uint64_t>[]> grown(new atomic<uint64_t>[capacity]);
+            for (size_t w = 0; w < capacity; ++w) {
+                grown[w].store(w < wordCount() ? words[w].load(memory_order_relaxed) : 0, memory_order_relaxed);
+            }
+            words = move(grown);
+            wordCapacity = capacity;
+        }
+        // Clear the bits past the new end so a later grow starts from clear flags
+        for (size_t bit = bits; bit < bitCount && bit % 64 != 0; ++bit) reset(bit);
+        for (size_t w = needed; w < wordCount(); ++w) words[w].store(0, memory_order_relaxed);
+        bitCount = bits;
+    }
+
+    bool test(size_t bit) const {
+        return (words[bit / 64].load(memory_order_acquire) >> (bit % 64)) & 1;
+    }
+
+    // Function to set a flag; returns false if it was already set
+    bool trySet(size_t bit) {
+        uint64_t mask = uint64_t(1) << (bit % 64);
+        return (words[bit / 64].fetch_or(mask, memory_order_acq_rel) & mask) == 0;
+    }
+
+    void set(size_t bit) { trySet(bit); }
+
+    void reset(size_t bit) {
+        words[bit / 64].fetch_and(~(uint64_t(1) << (bit % 64)), memory_order_acq_rel);
+    }
+
+    // Function to replace every flag with the given words (used by snapshot loading)
+    void assignWords(const uint64_t* source, size_t bits) {
+        bitCount = 0;
+        resize(bits);
+        for (size_t w = 0; w < wordCount(); ++w) words[w].store(source[w], memory_order_relaxed);
+    }
+
+    // Function to read a whole word of 64 flags
+    uint64_t word(size_t index) const {
+        return words[index].load(memory_order_relaxed);
+    }
+
+    // Function to count the flags that are set
+    size_t count() const {
+        size_t total = 0;
+        for (size_t w = 0; w < wordCount(); ++w) total += static_cast<size_t>(__builtin_popcountll(word(w)));
+        return total;
+    }
+};
+
+// AtomicColumn Class: Array of values that many threads can read and write
+// at once, one atomic per element. Like AtomicBitset, growing it must be
+// done while no other thread uses it.
+template <typename T>
+class AtomicColumn {
+private:
+    unique_ptr<atomic<T>[]> values; // The elements
+    size_t count = 0;               // Number of elements in use
+    size_t capacity = 0;            // Number of elements allocated
+
+public:
+    size_t size() const { return count; }
+
+    // Function to grow (or shrink) to the given size, filling new elements
+    void resize(size_t newSize, T fill) {
+        if (newSize > capacity) {
+            size_t grownCapacity = max(newSize, capacity * 2);
+            unique_ptr<atomic<T>[]> grown(new atomic<T>[grownCapacity]);
+            for (size_t i = 0; i < count; ++i) grown[i].store(values[i].load(memory_order_relaxed), memory_order_relaxed);
+            values = move(grown);
+            capacity = grownCapacity;
+        }
+        for (size_t i = count; i < newSize; ++i) values[i].store(fill, memory_order_relaxed);
+        count = newSize;
+    }
+
+    // Function to replace every element with the given values (used by snapshot loading)
+    void assign(const T* source, size_t size) {
+        resize(size, T());
+        for (size_t i = 0; i < size; ++i) values[i].store(source[i], memory_order_relaxed);
+    }
+
+    T load(size_t index) const { return values[index].load(memory_order_acquire); }
+    void store(size_t index, T value) { values[index].store(value, memory_order_release); }
+};
+
+// Snapshot file layout: a header, a table of sections, then the sections
+// themselves, each starting on a 64-byte boundary. Every section is a raw
+// array that the library can use in place once the file is mapped.
+enum class SnapshotSection : uint32_t {
+    stringBytes, stringSpans, internTable,
+    bookIsbns, bookTitles, bookAuthors, bookYears, bookGenres,
+    bookCheckedOut, bookBorrowers, bookLoanDays, bookOverdue, isbnTable,
+    patronNames, patronCards, patronFees, patronOverdueCounts, patronOverdueDueTotal, patronOwing, cardTable,
+    dueHeapSizes, dueHeapEntries,
+    count
+};
+
+struct SnapshotHeader {
+    char magic[8];            // "LIBSNAP" and a zero byte
+    uint32_t version;         // Format version, bumped on any layout change
+    uint32_t sectionCount;    // Number of entries in the section table
+    uint64_t generation;      // Increases with every snapshot saved
+    int32_t clockDay;         // Library clock when the snapshot was taken
+    uint32_t reserved;        // Always zero
+    uint64_t bookCount;       // Number of books
+    uint64_t patronCount;     // Number of patrons
+    uint64_t headerChecksum;  // Checksum of the header (with this field zero) and the section table
+};
+
+struct SnapshotSectionEntry {
+    uint32_t kind;            // A SnapshotSection value
+    uint32_t elementSize;     // Size of one element in bytes
+    uint64_t offset;          // Position of the first byte in the file
+    uint64_t count;           // Number of elements
+    uint64_t extra;           // Kind-specific value (entries used in a hash table, bits in a bitset)
+    uint64_t checksum;        // Checksum of the section's bytes
+};
+
+static const char snapshotMagic[8] = { 'L', 'I', 'B', 'S', 'N', 'A', 'P', '\0' };
+static const uint32_t snapshotVersion = 1;
+
+// SnapshotWriter Class: Writes the sections of a snapshot to a temporary
+// file and puts it in place atomically once the header is written
+class SnapshotWriter {
+private:
+    string path;                          // Final location of the snapshot
+    string tmpPath;                       // Where it is written first
+    int fd = -1;                          // Open temporary file
+    uint64_t position = 0;                // Current end of the file
+    vector<SnapshotSectionEntry> sections; // Table written at the end
+
+public:
+    explicit SnapshotWriter(const string& snapshotPath)
+        : path(snapshotPath), tmpPath(snapshotPath + ".tmp") {
+        fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw runtime_error("Cannot create " + tmpPath + ": " + strerror(errno));
+        }
+        // Leave room for the header and a full section table
+        position = sizeof(SnapshotHeader) + static_cast<size_t>(SnapshotSection::count) * sizeof(SnapshotSectionEntry);
+    }
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    ~SnapshotWriter() {
+        if (fd >= 0) {
+            ::close(fd);
+            ::unlink(tmpPath.c_str()); // Not finished: leave no partial snapshot behind
+        }
+    }
+
+    // Function to append one section
+    void add(SnapshotSection kind, const void* data, size_t elementSize, size_t count, uint64_t extra = 0) {
+        uint64_t aligned = (position + 63) / 64 * 64;
+        static const char zeros[64] = {};
+        if (::lseek(fd, static_cast<off_t>(position), SEEK_SET) < 0) {
+            throw runtime_error("Failed to seek in snapshot: " + string(strerror(errno)));
+        }
+        writeAll(fd, zeros, aligned - position);
+        size_t size = elementSize * count;
+        writeAll(fd, data, size);
+        sections.push_back({ static_cast<uint32_t>(kind), static_cast<uint32_t>(elementSize), aligned, count, extra,
+                             checksumBytes(data, size) });
+        position = aligned + size;
+    }
+
+    // Function to write the header and table, flush, and move the file into place
+    void finish(SnapshotHeader header) {
+        memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+        header.version = snapshotVersion;
+        header.sectionCount = static_cast<uint32_t>(sections.size());
+        header.reserved = 0;
+        header.headerChecksum = 0;
+        size_t tableSize = sections.size() * sizeof(SnapshotSectionEntry);
+        header.headerChecksum = checksumBytes(&header, sizeof(header)) ^ checksumBytes(sections.data(), tableSize);
+        if (::lseek(fd, 0, SEEK_SET) < 0) {
+            throw runtime_error("Failed to seek in snapshot: " + string(strerror(errno)));
+        }
+        writeAll(fd, &header, sizeof(header));
+        writeAll(fd, sections.data(), tableSize);
+        if (::fsync(fd) != 0 || ::close(fd) != 0) {
+            fd = -1;
+            throw runtime_error("Failed to write snapshot: " + string(strerror(errno)));
+        }
+        fd = -1;
+        if (::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            throw runtime_error("Failed to move snapshot into place: " + string(strerror(errno)));
+        }
+    }
+};
+
+// ReadMostlyMutex Class: Reader-writer lock for data that is read far more
+// often than it changes. Each reader counts itself in one of several
+// counters on their own cache lines (picked per thread), so desks reading
+// at once do not fight over a single reader count as they do with
+// shared_mutex. A writer raises its flag and waits for every counter to
+// drain; readers that see the flag back off until it is lowered. Works with
+// shared_lock and unique_lock. Shared locks must not be nested.
+class ReadMostlyMutex {
+private:
+    static constexpr size_t slotCount = 64;
+    struct alignas(64) Readers {
+        atomic<uint32_t> count{0};
+    };
+    Readers readers[slotCount];
+    atomic<bool> writing{false};
+    mutex writerMutex; // Lets one writer at a time raise the flag
+
+    static size_t slotOfThisThread() {
+        static atomic<size_t> nextSlot{0};
+        thread_local size_t slot = nextSlot.fetch_add(1, memory_order_relaxed) % slotCount;
+        return slot;
+    }
+
+public:
+    void lock_shared() {
+        Readers& mine = readers[slotOfThisThread()];
+        while (true) {
+            mine.count.fetch_add(1, memory_order_seq_cst);
+            if (!writing.load(memory_order_seq_cst)) return;
+            mine.count.fetch_sub(1, memory_order_release); // A writer is waiting: let it go first
+            while (writing.load(memory_order_acquire)) this_thread::yield();
+        }
+    }
+
+    void unlock_shared() {
+        readers[slotOfThisThread()].count.fetch_sub(1, memory_order_release);
+    }
+
+    void lock() {
+        writerMutex.lock();
+        writing.store(true, memory_order_seq_cst);
+        for (Readers& slot : readers) {
+            while (slot.count.load(memory_order_acquire) != 0) this_thread::yield();
+        }
+    }
+
+    void unlock() {
+        writing.store(false, memory_order_release);
+        writerMutex.unlock();
+    }
+};
+
+// Library Class: Represents the library that manages books and patrons.
+// Books and patrons are stored column by column (one array per field, with
+// strings interned in a pool), so scans that need one field only touch that
+// field's array. Book and Patron objects are views built on demand.
+// Circulation calls (checkOutBook, setPatronFees, lookups and reports) may run
+// from many desks at once. They share the catalog lock, claim a book with an
+// atomic flag and serialize only on the patron's shard. Adding books or
+// patrons and journal maintenance take the catalog lock exclusively.
+// Each loan is due loanPeriodDays after checkout. Loans sit in a min-heap
+// by due date (one heap per patron shard), so advanceClock only touches the
+// loans that have just become overdue. A patron's fees are then kept as
+// settled fees plus a running fine for their overdue books, which can be
+// read in constant time without walking their loans.
+class Library {
+private:
+    // Book columns: entry i of each column describes the book in slot i.
+    // Columns of type Column may view a loaded snapshot until first changed;
+    // the atomic ones are copied out of the snapshot when it is loaded.
+    Column<uint32_t> bookIsbns;    // Pool id of the ISBN
+    Column<uint32_t> bookTitles;   // Pool id of the title
+    Column<uint32_t> bookAuthors;  // Pool id of the author
+    Column<int16_t> bookYears;     // Copyright year (fits comfortably in 16 bits)
+    Column<uint8_t> bookGenres;    // Genre as its enum value
+    AtomicBitset checkedOut;       // Whether each book is checked out
+    AtomicColumn<uint32_t> borrowers; // Patron slot holding each book
+    AtomicColumn<int32_t> loanDays;   // Day each book was checked out
+    AtomicBitset overdue;          // Whether each loan has been counted as overdue
+    static constexpr uint32_t noPatron = UINT32_MAX; // Borrower value of a book on the shelf
+
+    // Patron columns: entry i of each column describes the patron in slot i
+    Column<uint32_t> patronNames;  // Pool id of the name
+    Column<uint32_t> patronCards;  // Pool id of the card number
+    // The next three columns are guarded by the patron's shard lock
+    vector<int32_t> patronFees;    // Settled fees owed (set by hand or charged at check-in)
+    vector<int32_t> overdueCounts; // Number of overdue books held
+    vector<int64_t> overdueDueTotal; // Sum of the due days of those books
+    AtomicBitset owingFees;        // Whether each patron owes fees
+
+    // Loan rules and the library's clock
+    static constexpr int32_t loanPeriodDays = 21; // Days a book may be kept
+    static constexpr int32_t dailyFine = 1;       // Fee per day a book is late
+    atomic<int32_t> clockDay{0};   // Latest day passed to advanceClock
+
+    // A loan waiting in a due-date heap; stale entries (for loans that have
+    // since ended) are recognized and dropped when they reach the top
+    struct DueEntry {
+        int32_t dueDay;
+        uint32_t book;
+        uint32_t patron;
+    };
+    static bool dueLater(const DueEntry& a, const DueEntry& b) { return a.dueDay > b.dueDay; }
+
+    StringPool strings;            // Storage for every string the library holds
+    Journal journal;               // Durable append-only record of the transactions
+    unique_ptr<FileMapping> snapshotFile; // Loaded snapshot the columns may still view
+    uint64_t snapshotGeneration = 0;      // Generation of the last snapshot saved or loaded (0: none)
+
+    // Primary indexes: map a unique key to a slot. The keys are read back
+    // from the pooled strings, so the tables are plain integer arrays.
+    FlatIndex isbnIndex;   // ISBN -> book slot
+    FlatIndex cardIndex;   // Card number -> patron slot
+    auto isbnOf() const { return [this](uint32_t slot) { return strings.get(bookIsbns[slot]); }; }
+    auto cardOf() const { return [this](uint32_t slot) { return strings.get(patronCards[slot]); }; }
+
+    // Secondary indexes: author pool id -> every book slot by that author,
+    // and the words of every title and author for catalog search. They are
+    // not stored in snapshots and are rebuilt on first use after a load.
+    mutable unordered_map<uint32_t, vector<uint32_t>> authorIndex;
+    mutable TextIndex textIndex;
+    mutable atomic<bool> secondaryIndexesReady{true};
+    mutable mutex secondaryIndexesMutex;
+
+    // Locks: the catalog lock protects the columns and indexes themselves,
+    // the shard locks protect the fee/checkout decision of the patrons in them
+    mutable ReadMostlyMutex catalogMutex;
+    static constexpr size_t patronShardCount = 64;
+    mutable array<mutex, patronShardCount> patronShards;
+    array<vector<DueEntry>, patronShardCount> dueHeaps; // Open loans of each shard's patrons
+
+    mutex& shardOf(size_t patronSlot) const {
+        return patronShards[patronSlot % patronShardCount];
+    }
+
+    size_t bookCount() const { return bookIsbns.size(); }
+    size_t patronCount() const { return patronNames.size(); }
+
+    // Functions to build views of a stored book or patron
+    Book bookAt(size_t slot) const {
+        return Book(strings.get(bookIsbns[slot]), strings.get(bookTitles[slot]), strings.get(bookAuthors[slot]),
+                    bookYears[slot], static_cast<Genre>(bookGenres[slot]), checkedOut.test(slot));
+    }
+    Patron patronAt(size_t slot) const {
+        lock_guard<mutex> shardLock(shardOf(slot));
+        return Patron(strings.get(patronNames[slot]), strings.get(patronCards[slot]), owedLocked(slot));
+    }
+
+    // Functions to find a slot by key (return false if not found). Lookups
+    // hash the caller's string_view directly, so they never allocate.
+    bool lookupBook(string_view isbn, uint32_t& slot) const {
+        return isbnIndex.find(isbn, isbnOf(), slot);
+    }
+    bool lookupPatron(string_view cardNumber, uint32_t& slot) const {
+        return cardIndex.find(cardNumber, cardOf(), slot);
+    }
+
+    // Function to add one book's entries to the secondary indexes
+    void indexBookSecondary(uint32_t slot) const {
+        authorIndex[bookAuthors[slot]].push_back(slot);
+        textIndex.addBook(slot, strings.get(bookTitles[slot]), strings.get(bookAuthors[slot]));
+    }
+
+    // Function to build the secondary indexes if a snapshot load left them
+    // out. Safe to call under the shared catalog lock: the columns cannot
+    // change, and only one caller builds while the others wait.
+    void ensureSecondaryIndexes() const {
+        if (secondaryIndexesReady.load(memory_order_acquire)) return;
+        lock_guard<mutex> building(secondaryIndexesMutex);
+        if (secondaryIndexesReady.load(memory_order_relaxed)) return;
+        for (size_t slot = 0; slot < bookCount(); ++slot) {
+            indexBookSecondary(static_cast<uint32_t>(slot));
+        }
+        secondaryIndexesReady.store(true, memory_order_release);
+    }
+
+    // Function to store a batch of books in the columns and indexes.
+    // On a duplicate ISBN the whole batch is removed again.
+    void appendBooks(const Book* records, size_t count) {
+        size_t firstSlot = bookCount();
+        size_t total = firstSlot + count;
+        if (count > 1) {
+            // Bulk loads size everything once; single adds rely on normal growth
+            strings.reserve(3 * count); // ISBN, title and author of each book
+            isbnIndex.reserve(total, isbnOf());
+            bookIsbns.reserve(total);
+            bookTitles.reserve(total);
+            bookAuthors.reserve(total);
+            bookYears.reserve(total);
+            bookGenres.reserve(total);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            bookIsbns.push_back(strings.add(records[i].getISBN()));
+            if (!isbnIndex.insert(static_cast<uint32_t>(firstSlot + i), isbnOf())) {
+                for (size_t undo = firstSlot; undo < firstSlot + i; ++undo) {
+                    isbnIndex.erase(strings.get(bookIsbns[undo]), isbnOf());
+                }
+                bookIsbns.resize(firstSlot);
+                throw runtime_error("Book with ISBN " + string(records[i].getISBN()) + " already exists.");
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const Book& record = records[i];
+            bookTitles.push_back(strings.intern(record.getTitle()));
+            bookAuthors.push_back(strings.intern(record.getAuthor()));
+            bookYears.push_back(static_cast<int16_t>(record.getCopyrightDate()));
+            bookGenres.push_back(static_cast<uint8_t>(record.getGenre()));
+            if (secondaryIndexesReady.load()) indexBookSecondary(static_cast<uint32_t>(firstSlot + i));
+        }
+        checkedOut.resize(total);
+        for (size_t i = 0; i < count; ++i) {
+            if (records[i].isCheckedOut()) checkedOut.set(firstSlot + i);
+        }
+        borrowers.resize(total, noPatron);
+        loanDays.resize(total, 0);
+        overdue.resize(total);
+    }
+
+    // Function to store a batch of patrons in the columns and index.
+    // On a duplicate card number the whole batch is removed again.
+    void appendPatrons(const Patron* records, size_t count) {
+        size_t firstSlot = patronCount();
+        size_t total = firstSlot + count;
+        if (count > 1) {
+            // Bulk loads size everything once; single adds rely on normal growth
+            strings.reserve(2 * count); // Card number and name of each patron
+            cardIndex.reserve(total, cardOf());
+            patronCards.reserve(total);
+            patronNames.reserve(total);
+            patronFees.reserve(total);
+            overdueCounts.reserve(total);
+            overdueDueTotal.reserve(total);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            patronCards.push_back(strings.add(records[i].getCardNumber()));
+            if (!cardIndex.insert(static_cast<uint32_t>(firstSlot + i), cardOf())) {
+                for (size_t undo = firstSlot; undo < firstSlot + i; ++undo) {
+                    cardIndex.erase(strings.get(patronCards[undo]), cardOf());
+                }
+                patronCards.resize(firstSlot);
+                throw runtime_error("Patron with card number " + string(records[i].getCardNumber()) + " already exists.");
+            }
+        }
+        owingFees.resize(total);
+        for (size_t i = 0; i < count; ++i) {
+            patronNames.push_back(strings.intern(records[i].getUserName()));
+            patronFees.push_back(records[i].getOwedFees());
+            overdueCounts.push_back(0);
+            overdueDueTotal.push_back(0);
+            if (records[i].owesFees()) owingFees.set(firstSlot + i);
+        }
+    }
+
+    // The functions below expect the caller to hold the patron's shard lock.
+
+    // Function to work out what a patron owes right now: settled fees plus
+    // the fine accrued so far on each overdue book (days past due times the
+    // daily fine), computed from the running count and due-day total
+    int owedLocked(size_t patronSlot) const {
+        int64_t lateDays = overdueCounts[patronSlot] * static_cast<int64_t>(clockDay.load()) - overdueDueTotal[patronSlot];
+        int64_t owed = patronFees[patronSlot] + lateDays * dailyFine;
+        return static_cast<int>(min<int64_t>(owed, INT32_MAX));
+    }
+
+    // Function to keep the owing flag in step with what the patron owes
+    void refreshOwing(size_t patronSlot) {
+        if (owedLocked(patronSlot) > 0) {
+            owingFees.set(patronSlot);
+        } else {
+            owingFees.reset(patronSlot);
+        }
+    }
+
+    // Function to store a patron's settled fees
+    void storeFees(size_t patronSlot, int fees) {
+        patronFees[patronSlot] = fees;
+        refreshOwing(patronSlot);
+    }
+
+    // Function to record a new loan of a book the caller has just claimed
+    void startLoan(uint32_t bookSlot, uint32_t patronSlot, int32_t day) {
+        borrowers.store(bookSlot, patronSlot);
+        loanDays.store(bookSlot, day);
+        vector<DueEntry>& heap = dueHeaps[patronSlot % patronShardCount];
+        heap.push_back({ day + loanPeriodDays, bookSlot, patronSlot });
+        push_heap(heap.begin(), heap.end(), dueLater);
+    }
+
+    // Function to end a loan on the given day, charging the late fine (if
+    // any) to the patron's settled fees. Returns the fine charged.
+    int endLoan(uint32_t bookSlot, uint32_t patronSlot, int32_t day) {
+        int32_t dueDay = loanDays.load(bookSlot) + loanPeriodDays;
+        if (overdue.test(bookSlot)) {
+            // The book no longer accrues a running fine
+            overdueCounts[patronSlot] -= 1;
+            overdueDueTotal[patronSlot] -= dueDay;
+            overdue.reset(bookSlot);
+        }
+        int fine = max(0, day - dueDay) * dailyFine;
+        patronFees[patronSlot] += fine;
+        borrowers.store(bookSlot, noPatron);
+        checkedOut.reset(bookSlot); // Last, so the book is only claimable once the loan is closed
+        refreshOwing(patronSlot);
+        return fine;
+    }
+
+    // Function to move a shard's loans that are due before the clock day
+    // into the overdue totals. Returns the number of loans that became overdue.
+    size_t collectOverdue(size_t shard, int32_t today) {
+        vector<DueEntry>& heap = dueHeaps[shard];
+        size_t newlyOverdue = 0;
+        while (!heap.empty() && heap.front().dueDay < today) {
+            DueEntry entry = heap.front();
+            pop_heap(heap.begin(), heap.end(), dueLater);
+            heap.pop_back();
+            // Skip entries whose loan has ended (or was already counted)
+            bool current = checkedOut.test(entry.book) && borrowers.load(entry.book) == entry.patron &&
+                           loanDays.load(entry.book) + loanPeriodDays == entry.dueDay;
+            if (!current || !overdue.trySet(entry.book)) continue;
+            overdueCounts[entry.patron] += 1;
+            overdueDueTotal[entry.patron] += entry.dueDay;
+            refreshOwing(entry.patron);
+            ++newlyOverdue;
+        }
+        return newlyOverdue;
+    }
+
+    // Function to check out one book to a patron whose shard lock the caller
+    // holds and whose fees have been checked. Sets bookSlot when it succeeds.
+    CirculationStatus checkOutLocked(string_view isbn, uint32_t patronSlot, int32_t day, uint32_t& bookSlot) {
+        if (!lookupBook(isbn, bookSlot)) {
+            return CirculationStatus::bookNotFound;
+        }
+        // Claim the book atomically; another desk may hold it already
+        if (!checkedOut.trySet(bookSlot)) {
+            return CirculationStatus::alreadyCheckedOut;
+        }
+        startLoan(bookSlot, patronSlot, day);
+        return CirculationStatus::ok;
+    }
+
+    // Function to check in a book whose borrower's shard lock the caller
+    // holds. The borrower is rechecked because another desk may have
+    // returned the book before the lock was taken.
+    CirculationStatus checkInLocked(uint32_t bookSlot, uint32_t patronSlot, int32_t day, int& fine) {
+        if (!checkedOut.test(bookSlot) || borrowers.load(bookSlot) != patronSlot) {
+            return CirculationStatus::notCheckedOut;
+        }
+        fine = endLoan(bookSlot, patronSlot, day);
+        return CirculationStatus::ok;
+    }
+
+    // Functions that make circulation changes under the catalog and shard
+    // locks and queue their journal records before the locks are released,
+    // so the journal keeps the order the changes happened in. They return
+    // the journal ticket; the public callers wait on it once unlocked.
+    uint64_t queueCheckOuts(const string_view* isbns, size_t count, string_view cardNumber, int32_t day,
+                            CirculationStatus* statuses) {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+
+        // Find the patron by card number
+        uint32_t patronSlot;
+        if (!lookupPatron(cardNumber, patronSlot)) {
+            fill(statuses, statuses + count, CirculationStatus::patronNotFound);
+            return 0;
+        }
+        lock_guard<mutex> shardLock(shardOf(patronSlot));
+        // Check if the patron owes fees (including fines on overdue books).
+        // New loans cannot change that, so one check covers the batch.
+        if (owedLocked(patronSlot) > 0) {
+            fill(statuses, statuses + count, CirculationStatus::patronOwesFees);
+            return 0;
+        }
+
+        vector<Transaction> records;
+        if (journal.isOpen()) records.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t bookSlot;
+            statuses[i] = checkOutLocked(isbns[i], patronSlot, day, bookSlot);
+            if (statuses[i] == CirculationStatus::ok && journal.isOpen()) {
+                records.emplace_back(bookSlot, patronSlot, Activity::checkOut, day);
+            }
+        }
+        return journal.append(records.data(), records.size());
+    }
+
+    uint64_t queueCheckIn(string_view isbn, int32_t day, int& fine) {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+
+        uint32_t bookSlot;
+        if (!lookupBook(isbn, bookSlot)) {
+            throw runtime_error(circulationStatusToString(CirculationStatus::bookNotFound));
+        }
+        uint32_t patronSlot = borrowers.load(bookSlot);
+        if (!checkedOut.test(bookSlot) || patronSlot == noPatron) {
+            throw runtime_error(circulationStatusToString(CirculationStatus::notCheckedOut));
+        }
+        lock_guard<mutex> shardLock(shardOf(patronSlot));
+        CirculationStatus status = checkInLocked(bookSlot, patronSlot, day, fine);
+        if (status != CirculationStatus::ok) {
+            throw runtime_error(circulationStatusToString(status));
+        }
+        return journal.append(Transaction(bookSlot, patronSlot, Activity::checkIn, day));
+    }
+
+    uint64_t queueCheckIns(const vector<string_view>& isbns, int32_t day, vector<CheckInResult>& results) {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+
+        // Resolve every book and its borrower, then order them by shard
+        struct Pending { uint32_t shard; uint32_t index; uint32_t book; uint32_t patron; };
+        vector<Pending> work;
+        work.reserve(isbns.size());
+        for (size_t i = 0; i < isbns.size(); ++i) {
+            uint32_t bookSlot;
+            if (!lookupBook(isbns[i], bookSlot)) {
+                results[i].status = CirculationStatus::bookNotFound;
+                continue;
+            }
+            uint32_t patronSlot = borrowers.load(bookSlot);
+            if (!checkedOut.test(bookSlot) || patronSlot == noPatron) continue;
+            work.push_back({ static_cast<uint32_t>(patronSlot % patronShardCount), static_cast<uint32_t>(i), bookSlot, patronSlot });
+        }
+        // Stable, so a book scanned twice is returned once, by its first scan
+        stable_sort(work.begin(), work.end(), [](const Pending& a, const Pending& b) { return a.shard < b.shard; });
+
+        uint64_t ticket = 0;
+        vector<Transaction> records;
+        for (size_t begin = 0; begin < work.size();) {
+            size_t end = begin;
+            lock_guard<mutex> shardLock(patronShards[work[begin].shard]);
+            records.clear();
+            for (; end < work.size() && work[end].shard == work[begin].shard; ++end) {
+                const Pending& item = work[end];
+                CheckInResult& result = results[item.index];
+                result.status = checkInLocked(item.book, item.patron, day, result.fine);
+                if (result.status == CirculationStatus::ok && journal.isOpen()) {
+                    records.emplace_back(item.book, item.patron, Activity::checkIn, day);
+                }
+            }
+            ticket = max(ticket, journal.append(records.data(), records.size()));
+            begin = end;
+        }
+        return ticket;
+    }
+
+    // Function to build a mask of the books in one 64-book word that have a genre
+    uint64_t genreMask(size_t word, Genre genre) const {
+        const uint8_t wanted = static_cast<uint8_t>(genre);
+        const size_t begin = word * 64;
+        const size_t end = min(begin + 64, bookCount());
+        const uint8_t* genres = bookGenres.data() + begin;
+        uint64_t mask = 0;
+        for (size_t i = 0; i < end - begin; ++i) {
+            mask |= static_cast<uint64_t>(genres[i] == wanted) << i;
+        }
+        return mask;
+    }
+
+    // Function to apply a replayed transaction (the catalog lock is held exclusively)
+    void apply(const Transaction& transaction) {
+        uint32_t id = transaction.getBookId();
+        uint32_t patron = transaction.getPatronId();
+        lock_guard<mutex> shardLock(shardOf(patron));
+        if (transaction.getActivity() == Activity::checkOut) {
+            if (checkedOut.trySet(id)) startLoan(id, patron, transaction.getDay());
+        } else if (transaction.getActivity() == Activity::checkIn) {
+            if (checkedOut.test(id) && borrowers.load(id) == patron) endLoan(id, patron, transaction.getDay());
+        } else if (transaction.getActivity() == Activity::setFees) {
+            storeFees(patron, transaction.getDay());
+        }
+    }
+
+public:
+    // Function to add a book to the library
+    void addBook(const Book& book) {
+        unique_lock<ReadMostlyMutex> lock(catalogMutex);
+        appendBooks(&book, 1);
+    }
+
+    // Function to add a patron to the library
+    void addPatron(const Patron& patron) {
+        unique_lock<ReadMostlyMutex> lock(catalogMutex);
+        appendPatrons(&patron, 1);
+    }
+
+    // Function to load books from a CSV or TSV file with the columns
+    // isbn, title, author, copyright year, genre (a header line is optional).
+    // Fields may be quoted as in RFC 4180. The file is memory-mapped
+    // copy-on-write (so "" can be collapsed in place) and split into
+    // parseThreads chunks parsed in parallel into views of the mapping; the
+    // columns and indexes are then filled once for the whole batch.
+    // Returns the number of books added.
+    size_t importBooks(const string& path, unsigned parseThreads = 1) {
+        FileMapping file(path, true, true);
+        char delimiter;
+        string_view text = prepareDelimitedText(file.view(), "isbn", delimiter);
+        auto chunks = splitIntoChunks(text, max(parseThreads, 1u));
+        auto parsed = parseChunksInParallel<Book>(chunks, [delimiter](string_view chunk, vector<Book>& out) {
+            out.reserve(static_cast<size_t>(count(chunk.begin(), chunk.end(), '\n')) + 1);
+            forEachRecord<5>(chunk, delimiter, [&](const array<string_view, 5>& f, size_t fieldCount) {
+                int year = 0;
+                Genre genre;
+                if (fieldCount != 5 || f[0].empty() ||
+                    !parseInteger(f[3], year) || !parseGenre(f[4], genre)) {
+                    throw runtime_error("Malformed book record for ISBN \"" + string(f[0]) + "\".");
+                }
+                out.emplace_back(f[0], f[1], f[2], year, genre);
+            });
+        });
+
+        unique_lock<ReadMostlyMutex> lock(catalogMutex);
+        size_t added = 0;
+        for (const auto& chunkBooks : parsed) {
+            appendBooks(chunkBooks.data(), chunkBooks.size());
+            added += chunkBooks.size();
+        }
+        return added;
+    }
+
+    // Function to load patrons from a CSV or TSV file with the columns
+    // name, card number and optionally owed fees (a header line is optional).
+    // Returns the number of patrons added.
+    size_t importPatrons(const string& path, unsigned parseThreads = 1) {
+        FileMapping file(path, true, true);
+        char delimiter;
+        string_view text = prepareDelimitedText(file.view(), "name", delimiter);
+        auto chunks = splitIntoChunks(text, max(parseThreads, 1u));
+        auto parsed = parseChunksInParallel<Patron>(chunks, [delimiter](string_view chunk, vector<Patron>& out) {
+            out.reserve(static_cast<size_t>(count(chunk.begin(), chunk.end(), '\n')) + 1);
+            forEachRecord<3>(chunk, delimiter, [&](const array<string_view, 3>& f, size_t fieldCount) {
+                int fees = 0;
+                if (fieldCount < 2 || fieldCount > 3 || f[1].empty() ||
+                    (fieldCount == 3 && !parseInteger(f[2], fees))) {
+                    throw runtime_error("Malformed patron record for \"" + string(f[0]) + "\".");
+                }
+                out.emplace_back(f[0], f[1], fees);
+            });
+        });
+
+        unique_lock<ReadMostlyMutex> lock(catalogMutex);
+        size_t added = 0;
+        for (const auto& chunkPatrons : parsed) {
+            appendPatrons(chunkPatrons.data(), chunkPatrons.size());
+            added += chunkPatrons.size();
+        }
+        return added;
+    }
+
+    // Function to find a book by ISBN
+    optional<Book> findBook(string_view isbn) const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        uint32_t slot;
+        if (!lookupBook(isbn, slot)) return nullopt;
+        return bookAt(slot);
+    }
+
+    // Function to find a patron by card number
+    optional<Patron> findPatron(string_view cardNumber) const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        uint32_t slot;
+        if (!lookupPatron(cardNumber, slot)) return nullopt;
+        return patronAt(slot);
+    }
+
+    // Function to return all books written by an author
+    vector<Book> booksByAuthor(string_view author) const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        ensureSecondaryIndexes();
+        vector<Book> result;
+        uint32_t authorId;
+        if (!strings.find(author, authorId)) return result;
+        auto it = authorIndex.find(authorId);
+        if (it != authorIndex.end()) {
+            result.reserve(it->second.size());
+            for (uint32_t slot : it->second) {
+                result.push_back(bookAt(slot));
+            }
+        }
+        return result;
+    }
+
+    // Function to search titles and authors for the words (or fragments of
+    // words) in a query and return up to limit books, best match first
+    vector<Book> searchCatalog(string_view query, size_t limit = 10) const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        ensureSecondaryIndexes();
+        vector<Book> result;
+        for (uint32_t slot : textIndex.search(query, limit)) {
+            result.push_back(bookAt(slot));
+        }
+        return result;
+    }
+
+    // Function to return the books of a genre that are not checked out
+    vector<Book> availableBooksInGenre(Genre genre) const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        vector<Book> result;
+        for (size_t w = 0; w < checkedOut.wordCount(); ++w) {
+            uint64_t hits = genreMask(w, genre) & ~checkedOut.word(w);
+            while (hits != 0) {
+                result.push_back(bookAt(w * 64 + static_cast<size_t>(__builtin_ctzll(hits))));
+                hits &= hits - 1; // Clear the lowest set bit
+            }
+        }
+        return result;
+    }
+
+    // Function to count the books of a genre that are not checked out
+    size_t countAvailableInGenre(Genre genre) const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        size_t total = 0;
+        for (size_t w = 0; w < checkedOut.wordCount(); ++w) {
+            total += static_cast<size_t>(__builtin_popcountll(genreMask(w, genre) & ~checkedOut.word(w)));
+        }
+        return total;
+    }
+
+    // Function to count the books in the catalog
+    size_t countBooks() const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        return bookCount();
+    }
+
+    // Function to count the registered patrons
+    size_t countPatrons() const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        return patronCount();
+    }
+
+    // Function to count the books that are checked out
+    size_t countCheckedOut() const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        return checkedOut.count();
+    }
+
+    // Function to count the books with a copyright year before the given year
+    size_t countPublishedBefore(int year) const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        const int16_t limit = static_cast<int16_t>(max(min(year, 32767), -32768));
+        const int16_t* years = bookYears.data();
+        size_t total = 0;
+        for (size_t i = 0; i < bookCount(); ++i) {
+            total += years[i] < limit;
+        }
+        return total;
+    }
+
+    // Function to change what a patron owes. Holding the patron's shard lock
+    // means no checkout for this patron can be half-way through its fee check.
+    void setPatronFees(string_view cardNumber, int fees) {
+        uint64_t ticket;
+        {
+            shared_lock<ReadMostlyMutex> lock(catalogMutex);
+            uint32_t patronSlot;
+            if (!lookupPatron(cardNumber, patronSlot)) {
+                throw runtime_error("Patron not found in library.");
+            }
+            lock_guard<mutex> shardLock(shardOf(patronSlot));
+            storeFees(patronSlot, fees);
+            ticket = journal.append(Transaction(0, patronSlot, Activity::setFees, fees));
+        }
+        journal.waitDurable(ticket);
+    }
+
+    // Function to check out a book
+    void checkOutBook(string_view isbn, string_view cardNumber, const string& date) {
+        CirculationStatus status;
+        checkOutBooks(&isbn, 1, cardNumber, date, &status);
+        if (status != CirculationStatus::ok) {
+            throw runtime_error(circulationStatusToString(status));
+        }
+    }
+
+    // Function to check out several books to one patron, as a self-checkout
+    // kiosk does. The patron is looked up, locked and fee-checked once for
+    // the whole batch, and the loans are journaled together. Writes one
+    // status per book instead of throwing, so rejected items stay cheap.
+    void checkOutBooks(const string_view* isbns, size_t count, string_view cardNumber, const string& date,
+                       CirculationStatus* statuses) {
+        journal.waitDurable(queueCheckOuts(isbns, count, cardNumber, dateToEpochDay(date), statuses));
+    }
+
+    vector<CirculationStatus> checkOutBooks(const vector<string_view>& isbns, string_view cardNumber, const string& date) {
+        vector<CirculationStatus> statuses(isbns.size());
+        checkOutBooks(isbns.data(), isbns.size(), cardNumber, date, statuses.data());
+        return statuses;
+    }
+
+    // Function to check in a book. A book returned after its due date costs
+    // the borrower the daily fine for each late day. Returns the fine charged.
+    int checkInBook(string_view isbn, const string& date) {
+        int fine = 0;
+        journal.waitDurable(queueCheckIn(isbn, dateToEpochDay(date), fine));
+        return fine;
+    }
+
+    // Function to check in a batch of returned books, such as the scanned
+    // end-of-day returns. The books are grouped by their borrowers' shards
+    // so each shard is locked once, and the returns are journaled together.
+    // Returns a status and the fine charged for each book, in input order.
+    vector<CheckInResult> checkInBooks(const vector<string_view>& isbns, const string& date) {
+        vector<CheckInResult> results(isbns.size(), { CirculationStatus::notCheckedOut, 0 });
+        journal.waitDurable(queueCheckIns(isbns, dateToEpochDay(date), results));
+        return results;
+    }
+
+    // Function to move the library's clock forward to a date. Loans due
+    // before that date become overdue and start accruing fines for their
+    // borrowers; only those loans are visited. Returns how many became overdue.
+    size_t advanceClock(const string& date) {
+        int32_t today = dateToEpochDay(date);
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        int32_t previous = clockDay.load();
+        while (previous < today && !clockDay.compare_exchange_weak(previous, today)) {
+        }
+        today = clockDay.load(); // The clock never moves backwards
+        size_t newlyOverdue = 0;
+        for (size_t shard = 0; shard < patronShardCount; ++shard) {
+            lock_guard<mutex> shardLock(patronShards[shard]);
+            newlyOverdue += collectOverdue(shard, today);
+        }
+        return newlyOverdue;
+    }
+
+    // Function to attach a journal file. Records written since its last
+    // checkpoint are replayed first, so books and patrons must already be
+    // added (or loaded from a snapshot) as when the journal was written.
+    // A journal from before the loaded snapshot is already contained in it,
+    // so it is reset instead of replayed. Otherwise the clock is moved on to
+    // the checkpoint's day, as loadSnapshot does with the snapshot's, so
+    // loans that were overdue then count as overdue again.
+    void openJournal(const string& path) {
+        unique_lock<ReadMostlyMutex> lock(catalogMutex);
+        uint64_t journalGeneration;
+        int32_t checkpointDay;
+        vector<Transaction> records = Journal::readSinceCheckpoint(path, journalGeneration, checkpointDay);
+        if (journalGeneration > snapshotGeneration) {
+            throw runtime_error("Journal continues a newer snapshot than the one loaded.");
+        }
+        bool stale = journalGeneration < snapshotGeneration;
+        if (!stale) {
+            for (const Transaction& transaction : records) {
+                if (transaction.getBookId() >= bookCount() || transaction.getPatronId() >= patronCount()) {
+                    throw runtime_error("Journal refers to a book or patron that is not in the library.");
+                }
+                apply(transaction);
+            }
+            if (checkpointDay > clockDay.load()) {
+                clockDay.store(checkpointDay);
+                for (size_t shard = 0; shard < patronShardCount; ++shard) {
+                    lock_guard<mutex> shardLock(patronShards[shard]);
+                    collectOverdue(shard, checkpointDay);
+                }
+            }
+        }
+        journal.open(path);
+        if (stale) {
+            journal.rewrite(clockDay.load(), {}, snapshotGeneration);
+        }
+    }
+
+    // Function to make every journaled transaction durable now
+    void syncJournal() {
+        journal.commit();
+    }
+
+    // Function to compact the journal down to the settled fees and the loans
+    // that are still open, which bounds replay time at the next startup
+    void checkpoint(const string& date) {
+        unique_lock<ReadMostlyMutex> lock(catalogMutex);
+        if (!journal.isOpen()) {
+            throw runtime_error("No journal is open.");
+        }
+        journal.commit();
+        // Settled fees first, then one checkout record per open loan
+        vector<Transaction> state;
+        for (size_t slot = 0; slot < patronCount(); ++slot) {
+            if (patronFees[slot] != 0) {
+                state.emplace_back(0, static_cast<uint32_t>(slot), Activity::setFees, patronFees[slot]);
+            }
+        }
+        for (size_t slot = 0; slot < bookCount(); ++slot) {
+            if (borrowers.load(slot) != noPatron) {
+                state.emplace_back(static_cast<uint32_t>(slot), borrowers.load(slot), Activity::checkOut, loanDays.load(slot));
+            }
+        }
+        journal.rewrite(dateToEpochDay(date), state, snapshotGeneration);
+    }
+
+    // Function to save the whole library (strings, columns, primary indexes,
+    // loans and fees) as a binary snapshot that loadSnapshot can map back in.
+    // If a journal is attached it is reset afterwards, since everything it
+    // held is now in the snapshot. Blocks all other calls while it runs.
+    void saveSnapshot(const string& path) {
+        unique_lock<ReadMostlyMutex> lock(catalogMutex);
+        journal.commit();
+        SnapshotWriter writer(path);
+
+        // All strings go into one byte array that becomes block 0 when loaded
+        vector<char> bytes;
+        vector<StringPool::Span> spans(strings.size());
+        for (uint32_t id = 0; id < strings.size(); ++id) {
+            string_view text = strings.get(id);
+            spans[id] = { bytes.size(), static_cast<uint32_t>(text.size()), 0 };
+            bytes.insert(bytes.end(), text.begin(), text.end());
+        }
+        writer.add(SnapshotSection::stringBytes, bytes.data(), 1, bytes.size());
+        writer.add(SnapshotSection::stringSpans, spans.data(), sizeof(StringPool::Span), spans.size());
+        const FlatIndex& intern = strings.internTable();
+        writer.add(SnapshotSection::internTable, intern.data(), sizeof(uint32_t), intern.capacity(), intern.size());
+
+        // Copies of the atomic state, taken while nothing can change it
+        auto bitsetWords = [](const AtomicBitset& bits) {
+            vector<uint64_t> words(bits.wordCount());
+            for (size_t w = 0; w < words.size(); ++w) words[w] = bits.word(w);
+            return words;
+        };
+        auto columnValues = [](const auto& column) {
+            vector<decltype(column.load(0))> values(column.size());
+            for (size_t i = 0; i < values.size(); ++i) values[i] = column.load(i);
+            return values;
+        };
+
+        writer.add(SnapshotSection::bookIsbns, bookIsbns.data(), sizeof(uint32_t), bookCount());
+        writer.add(SnapshotSection::bookTitles, bookTitles.data(), sizeof(uint32_t), bookCount());
+        writer.add(SnapshotSection::bookAuthors, bookAuthors.data(), sizeof(uint32_t), bookCount());
+        writer.add(SnapshotSection::bookYears, bookYears.data(), sizeof(int16_t), bookCount());
+        writer.add(SnapshotSection::bookGenres, bookGenres.data(), sizeof(uint8_t), bookCount());
+        auto outWords = bitsetWords(checkedOut);
+        writer.add(SnapshotSection::bookCheckedOut, outWords.data(), sizeof(uint64_t), outWords.size(), bookCount());
+        auto borrowerValues = columnValues(borrowers);
+        writer.add(SnapshotSection::bookBorrowers, borrowerValues.data(), sizeof(uint32_t), borrowerValues.size());
+        auto loanDayValues = columnValues(loanDays);
+        writer.add(SnapshotSection::bookLoanDays, loanDayValues.data(), sizeof(int32_t), loanDayValues.size());
+        auto overdueWords = bitsetWords(overdue);
+        writer.add(SnapshotSection::bookOverdue, overdueWords.data(), sizeof(uint64_t), overdueWords.size(), bookCount());
+        writer.add(SnapshotSection::isbnTable, isbnIndex.data(), sizeof(uint32_t), isbnIndex.capacity(), isbnIndex.size());
+
+        writer.add(SnapshotSection::patronNames, patronNames.data(), sizeof(uint32_t), patronCount());
+        writer.add(SnapshotSection::patronCards, patronCards.data(), sizeof(uint32_t), patronCount());
+        writer.add(SnapshotSection::patronFees, patronFees.data(), sizeof(int32_t), patronCount());
+        writer.add(SnapshotSection::patronOverdueCounts, overdueCounts.data(), sizeof(int32_t), patronCount());
+        writer.add(SnapshotSection::patronOverdueDueTotal, overdueDueTotal.data(), sizeof(int64_t), patronCount());
+        auto owingWords = bitsetWords(owingFees);
+        writer.add(SnapshotSection::patronOwing, owingWords.data(), sizeof(uint64_t), owingWords.size(), patronCount());
+        writer.add(SnapshotSection::cardTable, cardIndex.data(), sizeof(uint32_t), cardIndex.capacity(), cardIndex.size());
+
+        vector<uint64_t> heapSizes;
+        vector<DueEntry> heapEntries;
+        for (const auto& heap : dueHeaps) {
+            heapSizes.push_back(heap.size());
+            heapEntries.insert(heapEntries.end(), heap.begin(), heap.end());
+        }
+        writer.add(SnapshotSection::dueHeapSizes, heapSizes.data(), sizeof(uint64_t), heapSizes.size());
+        writer.add(SnapshotSection::dueHeapEntries, heapEntries.data(), sizeof(DueEntry), heapEntries.size());
+
+        SnapshotHeader header = {};
+        header.generation = snapshotGeneration + 1;
+        header.clockDay = clockDay.load();
+        header.bookCount = bookCount();
+        header.patronCount = patronCount();
+        writer.finish(header);
+        snapshotGeneration = header.generation;
+
+        if (journal.isOpen()) {
+            journal.rewrite(clockDay.load(), {}, snapshotGeneration);
+        }
+    }
+
+    // Function to load a snapshot into an empty library. The file is mapped
+    // and the catalog columns, strings and primary indexes are used in place
+    // (copied only when first changed), so startup does no per-record work.
+    // Circulation state is copied out in bulk; the author and search indexes
+    // are rebuilt on first use. The header, and every string offset, id and
+    // index slot, are always bounds-checked; pass verifyChecksums to also
+    // checksum every section (reads the whole file).
+    void loadSnapshot(const string& path, bool verifyChecksums = false) {
+        unique_lock<ReadMostlyMutex> lock(catalogMutex);
+        if (bookCount() != 0 || patronCount() != 0 || strings.size() != 0) {
+            throw runtime_error("A snapshot can only be loaded into an empty library.");
+        }
+        auto file = make_unique<FileMapping>(path, false);
+        string_view bytes = file->view();
+        auto corrupt = [&](const string& why) { return runtime_error("Snapshot " + path + " is unusable: " + why); };
+
+        // Header and section table
+        SnapshotHeader header;
+        if (bytes.size() < sizeof(header)) throw corrupt("file too small");
+        memcpy(&header, bytes.data(), sizeof(header));
+        if (memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0) throw corrupt("not a library snapshot");
+        if (header.version != snapshotVersion) throw corrupt("unsupported version " + to_string(header.version));
+        size_t tableSize = static_cast<size_t>(header.sectionCount) * sizeof(SnapshotSectionEntry);
+        if (header.sectionCount > static_cast<uint32_t>(SnapshotSection::count) || bytes.size() < sizeof(header) + tableSize) {
+            throw corrupt("bad section table");
+        }
+        const auto* table = reinterpret_cast<const SnapshotSectionEntry*>(bytes.data() + sizeof(header));
+        uint64_t savedChecksum = header.headerChecksum;
+        header.headerChecksum = 0;
+        if ((checksumBytes(&header, sizeof(header)) ^ checksumBytes(table, tableSize)) != savedChecksum) {
+            throw corrupt("header checksum mismatch");
+        }
+
+        array<const SnapshotSectionEntry*, static_cast<size_t>(SnapshotSection::count)> found = {};
+        for (uint32_t i = 0; i < header.sectionCount; ++i) {
+            const SnapshotSectionEntry& entry = table[i];
+            if (entry.kind >= found.size() || entry.offset % 64 != 0 || entry.elementSize == 0 ||
+                entry.count > (bytes.size() - min<uint64_t>(entry.offset, bytes.size())) / entry.elementSize) {
+                throw corrupt("section out of bounds");
+            }
+            if (verifyChecksums && checksumBytes(bytes.data() + entry.offset, entry.elementSize * entry.count) != entry.checksum) {
+                throw corrupt("section checksum mismatch");
+            }
+            found[entry.kind] = &entry;
+        }
+        // Function to fetch a section, checking its element size and count
+        auto section = [&](SnapshotSection kind, size_t elementSize, size_t expectedCount = SIZE_MAX) {
+            const SnapshotSectionEntry* entry = found[static_cast<size_t>(kind)];
+            if (entry == nullptr || entry->elementSize != elementSize ||
+                (expectedCount != SIZE_MAX && entry->count != expectedCount)) {
+                throw corrupt("missing or malformed section " + to_string(static_cast<uint32_t>(kind)));
+            }
+            return entry;
+        };
+        auto at = [&](const SnapshotSectionEntry* entry) { return bytes.data() + entry->offset; };
+        auto isPowerOfTwo = [](uint64_t n) { return n != 0 && (n & (n - 1)) == 0; };
+
+        size_t books = header.bookCount, patrons = header.patronCount;
+        size_t bookWords = (books + 63) / 64, patronWords = (patrons + 63) / 64;
+        auto stringBytes = section(SnapshotSection::stringBytes, 1);
+        auto spans = section(SnapshotSection::stringSpans, sizeof(StringPool::Span));
+        auto intern = section(SnapshotSection::internTable, sizeof(uint32_t));
+        auto isbnTable = section(SnapshotSection::isbnTable, sizeof(uint32_t));
+        auto cardTable = section(SnapshotSection::cardTable, sizeof(uint32_t));
+        auto heapSizes = section(SnapshotSection::dueHeapSizes, sizeof(uint64_t), patronShardCount);
+        auto heapEntries = section(SnapshotSection::dueHeapEntries, sizeof(DueEntry));
+        for (auto index : { intern, isbnTable, cardTable }) {
+            if (!isPowerOfTwo(index->count) || index->extra * 2 > index->count) throw corrupt("bad hash table");
+        }
+        auto isbnIds = section(SnapshotSection::bookIsbns, 4, books);
+        auto titleIds = section(SnapshotSection::bookTitles, 4, books);
+        auto authorIds = section(SnapshotSection::bookAuthors, 4, books);
+        auto genres = section(SnapshotSection::bookGenres, 1, books);
+        auto nameIds = section(SnapshotSection::patronNames, 4, patrons);
+        auto cardIds = section(SnapshotSection::patronCards, 4, patrons);
+        auto borrowerSlots = section(SnapshotSection::bookBorrowers, 4, books);
+
+        // Bounds: a damaged file must never send a lookup outside the mapping,
+        // so every span, id and slot is checked whether or not checksums are
+        auto stringSpans = reinterpret_cast<const StringPool::Span*>(at(spans));
+        for (size_t id = 0; id < spans->count; ++id) {
+            const StringPool::Span& span = stringSpans[id];
+            if (span.block != 0 || span.offset > stringBytes->count || span.length > stringBytes->count - span.offset) {
+                throw corrupt("string out of bounds");
+            }
+        }
+        auto valuesBelow = [&](const SnapshotSectionEntry* entry, size_t limit) {
+            auto values = reinterpret_cast<const uint32_t*>(at(entry));
+            return all_of(values, values + entry->count, [limit](uint32_t value) { return value < limit; });
+        };
+        // Hash slots hold value + 1 (0 when empty); the used count must match
+        // too, or a probe could run forever in a table with no empty slot
+        auto slotsBelow = [&](const SnapshotSectionEntry* index, size_t limit) {
+            auto slots = reinterpret_cast<const uint32_t*>(at(index));
+            size_t used = 0;
+            for (size_t i = 0; i < index->count; ++i) {
+                if (slots[i] == 0) continue;
+                if (slots[i] > limit) return false;
+                ++used;
+            }
+            return used == index->extra;
+        };
+        for (auto ids : { isbnIds, titleIds, authorIds, nameIds, cardIds }) {
+            if (!valuesBelow(ids, spans->count)) throw corrupt("string id out of range");
+        }
+        if (!slotsBelow(intern, spans->count) || !slotsBelow(isbnTable, books) || !slotsBelow(cardTable, patrons)) {
+            throw corrupt("index slot out of range");
+        }
+        auto genreValues = reinterpret_cast<const uint8_t*>(at(genres));
+        if (!all_of(genreValues, genreValues + books, [](uint8_t genre) { return genre < genreCount; })) {
+            throw corrupt("genre out of range");
+        }
+        auto borrowerValues = reinterpret_cast<const uint32_t*>(at(borrowerSlots));
+        if (!all_of(borrowerValues, borrowerValues + books,
+                    [patrons](uint32_t patron) { return patron == noPatron || patron < patrons; })) {
+            throw corrupt("borrower out of range");
+        }
+        auto entries = reinterpret_cast<const DueEntry*>(at(heapEntries));
+        if (!all_of(entries, entries + heapEntries->count,
+                    [books, patrons](const DueEntry& entry) { return entry.book < books && entry.patron < patrons; })) {
+            throw corrupt("due-date entry out of range");
+        }
+
+        // Catalog: viewed in place
+        strings.view(at(stringBytes), stringSpans, spans->count,
+                     reinterpret_cast<const uint32_t*>(at(intern)), intern->count, intern->extra);
+        bookIsbns.view(reinterpret_cast<const uint32_t*>(at(isbnIds)), books);
+        bookTitles.view(reinterpret_cast<const uint32_t*>(at(titleIds)), books);
+        bookAuthors.view(reinterpret_cast<const uint32_t*>(at(authorIds)), books);
+        bookYears.view(reinterpret_cast<const int16_t*>(at(section(SnapshotSection::bookYears, 2, books))), books);
+        bookGenres.view(genreValues, books);
+        patronNames.view(reinterpret_cast<const uint32_t*>(at(nameIds)), patrons);
+        patronCards.view(reinterpret_cast<const uint32_t*>(at(cardIds)), patrons);
+        isbnIndex.view(reinterpret_cast<const uint32_t*>(at(isbnTable)), isbnTable->count, isbnTable->extra);
+        cardIndex.view(reinterpret_cast<const uint32_t*>(at(cardTable)), cardTable->count, cardTable->extra);
+
+        // Circulation state: copied in bulk, since desks change it concurrently
+        checkedOut.assignWords(reinterpret_cast<const uint64_t*>(at(section(SnapshotSection::bookCheckedOut, 8, bookWords))), books);
+        overdue.assignWords(reinterpret_cast<const uint64_t*>(at(section(SnapshotSection::bookOverdue, 8, bookWords))), books);
+        owingFees.assignWords(reinterpret_cast<const uint64_t*>(at(section(SnapshotSection::patronOwing, 8, patronWords))), patrons);
+        borrowers.assign(borrowerValues, books);
+        loanDays.assign(reinterpret_cast<const int32_t*>(at(section(SnapshotSection::bookLoanDays, 4, books))), books);
+        auto fees = reinterpret_cast<const int32_t*>(at(section(SnapshotSection::patronFees, 4, patrons)));
+        auto counts = reinterpret_cast<const int32_t*>(at(section(SnapshotSection::patronOverdueCounts, 4, patrons)));
+        auto dueTotals = reinterpret_cast<const int64_t*>(at(section(SnapshotSection::patronOverdueDueTotal, 8, patrons)));
+        patronFees.assign(fees, fees + patrons);
+        overdueCounts.assign(counts, counts + patrons);
+        overdueDueTotal.assign(dueTotals, dueTotals + patrons);
+        auto sizes = reinterpret_cast<const uint64_t*>(at(heapSizes));
+        size_t used = 0;
+        for (size_t shard = 0; shard < patronShardCount; ++shard) {
+            if (sizes[shard] > heapEntries->count - used) throw corrupt("bad due-date heaps");
+            dueHeaps[shard].assign(entries + used, entries + used + sizes[shard]);
+            used += sizes[shard];
+        }
+
+        clockDay.store(header.clockDay);
+        snapshotGeneration = header.generation;
+        secondaryIndexesReady.store(false);
+        snapshotFile = move(file);
+    }
+
+
+    // Function to return the names of the patrons who owe fees. The names
+    // view the library's string pool, so nothing is copied.
+    vector<string_view> patronsOwingFees() const {
+        shared_lock<ReadMostlyMutex> lock(catalogMutex);
+        vector<string_view> owingPatrons;
+        for (size_t w = 0; w < owingFees.wordCount(); ++w) {
+            uint64_t owing = owingFees.word(w);
+            while (owing != 0) {
+                owingPatrons.push_back(strings.get(patronNames[w * 64 + static_cast<size_t>(__builtin_ctzll(owing))]));
+                owing &= owing - 1; // Clear the lowest set bit
+            }
+        }
+        return owingPatrons;
+    }
+};
+
+// Function to run many desks against one library at the same time and check
+// that no copy is ever lent twice and no patron owing fees gets a book.
+// With a journal path, every transaction is also journaled (to a fresh file).
+// Prints the throughput and returns the number of rule violations found.
+long runStressTest(unsigned threadCount, const string& journalPath) {
+    const size_t bookCount = 20000;
+    const size_t patronCount = 2000;
+    const size_t attemptsPerThread = 100000;
+
+    Library library;
+    for (size_t i = 0; i < bookCount; ++i) {
+        library.addBook(Book("isbn-" + to_string(i), "Title " + to_string(i), "Author " + to_string(i % 500),
+                             1900 + static_cast<int>(i % 120), static_cast<Genre>(i % genreCount)));
+    }
+    for (size_t i = 0; i < patronCount; ++i) {
+        library.addPatron(Patron("Patron " + to_string(i), "card-" + to_string(i)));
+    }
+    if (!journalPath.empty()) {
+        ::unlink(journalPath.c_str());
+        library.openJournal(journalPath);
+    }
+
+    unique_ptr<atomic<int>[]> wins(new atomic<int>[bookCount]());      // Successful checkouts per book
+    unique_ptr<atomic<bool>[]> blocked(new atomic<bool>[patronCount]()); // Patrons known to owe fees
+    atomic<long> successes(0), violations(0);
+    atomic<bool> stop(false);
+
+    // One desk keeps charging fees to patrons while the others check out books
+    thread feeDesk([&] {
+        mt19937 rng(12345);
+        while (!stop.load()) {
+            size_t patron = rng() % patronCount;
+            library.setPatronFees("card-" + to_string(patron), 5);
+            blocked[patron].store(true); // From here on this patron must be refused
+            this_thread::yield();
+        }
+    });
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> desks;
+    for (unsigned t = 0; t < threadCount; ++t) {
+        desks.emplace_back([&, t] {
+            mt19937 rng(t + 1);
+            for (size_t attempt = 0; attempt < attemptsPerThread; ++attempt) {
+                size_t book = rng() % bookCount;
+                size_t patron = rng() % patronCount;
+                bool owedBefore = blocked[patron].load();
+                try {
+                    library.checkOutBook("isbn-" + to_string(book), "card-" + to_string(patron), "2024-11-25");
+                } catch (const runtime_error&) {
+                    continue; // Refusals are expected under contention
+                }
+                successes.fetch_add(1);
+                wins[book].fetch_add(1);
+                if (owedBefore) {
+                    violations.fetch_add(1); // Lent to a patron already known to owe fees
+                }
+            }
+        });
+    }
+    for (auto& desk : desks) desk.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    stop.store(true);
+    feeDesk.join();
+
+    // Every book must have been lent at most once, and the library must agree
+    size_t checkedOut = library.countCheckedOut();
+    for (size_t i = 0; i < bookCount; ++i) {
+        if (wins[i].load() > 1) violations.fetch_add(1);
+    }
+    if (checkedOut != static_cast<size_t>(successes.load())) violations.fetch_add(1);
+
+    size_t attempts = attemptsPerThread * threadCount;
+    cout << threadCount << " desk(s): " << attempts << " attempts, " << successes.load() << " checkouts, "
+         << static_cast<long>(attempts / seconds) << " attempts/s, " << violations.load() << " violations\n";
+    return violations.load();
+}
+
+// Function to run the stress test with 1, 2, 4 ... up to maxDesks desks, so
+// the throughput at each count shows how circulation scales with desks.
+// Returns the rule violations found over all runs.
+long runStressScaling(unsigned maxDesks, const string& journalPath) {
+    cout << "Stress test" << (journalPath.empty() ? "" : " (journaled to " + journalPath + ")") << "\n";
+    long violations = 0;
+    for (unsigned desks = 1;; desks = min(desks * 2, maxDesks)) {
+        violations += runStressTest(desks, journalPath);
+        if (desks == maxDesks) break;
+    }
+    cout << "Rule violations: " << violations << "\n";
+    return violations;
+}
+
+// ZipfGenerator Class: Draws ranks 0..count-1 where rank r comes up with
+// probability close to 1/(r+1)^exponent, by inverting the continuous power
+// law. Needs no per-rank table, so it works for catalogs of any size.
+class ZipfGenerator {
+private:
+    size_t count;     // Number of ranks
+    double exponent;  // Skew; 0 is uniform, around 1 is typical for circulation
+    double span;      // (count+1)^(1-exponent) - 1, or log(count+1) when exponent is 1
+
+public:
+    ZipfGenerator(size_t rankCount, double skew) : count(rankCount), exponent(skew) {
+        span = isOne() ? log(count + 1.0) : pow(count + 1.0, 1.0 - exponent) - 1.0;
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng& rng) {
+        double u = generate_canonical<double, 53>(rng);
+        double x = isOne() ? exp(u * span) : pow(1.0 + u * span, 1.0 / (1.0 - exponent));
+        return min(static_cast<size_t>(x) - 1, count - 1);
+    }
+
+private:
+    bool isOne() const { return fabs(exponent - 1.0) < 1e-9; }
+};
+
+// Function to pick a multiplier coprime to count, so that rank * multiplier
+// mod count scatters popular ranks across the catalog instead of the front
+size_t scatterStride(size_t count) {
+    size_t stride = 2654435761u % max<size_t>(count, 1);
+    while (gcd(stride, count) != 1) ++stride;
+    return stride;
+}
+
+// Functions to make the fields of synthetic book and patron number i
+string syntheticIsbn(size_t i) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "978%010zu", i);
+    return buffer;
+}
+
+string syntheticCard(size_t i) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "C%09zu", i);
+    return buffer;
+}
+
+string syntheticTitle(size_t i) {
+    static const char* const words[] = { "Silent", "River", "Empire", "Garden", "Winter", "Shadow", "Letters",
+                                         "Harbor", "Machine", "Orchard", "Stone", "Crown", "Atlas", "Ember",
+                                         "Voyage", "Lantern", "Meadow", "Signal", "Thread", "Summit" };
+    const size_t wordCount = sizeof(words) / sizeof(words[0]);
+    uint64_t h = (i + 1) * 0x9E3779B97F4A7C15ull;
+    return string(words[h % wordCount]) + " " + words[(h >> 16) % wordCount] + " " + words[(h >> 32) % wordCount] +
+           " " + to_string(i);
+}
+
+string syntheticAuthor(size_t i, size_t authorCount) {
+    return "Author " + to_string(i % authorCount);
+}
+
+// LatencySamples Class: Per-call latencies of one operation, reported as
+// throughput and percentiles in a JSON object
+class LatencySamples {
+private:
+    vector<uint32_t> samples; // Nanoseconds per call (capped at about 4 s)
+    uint64_t totalNanos = 0;  // Time spent inside the measured calls
+
+public:
+    void reserve(size_t count) { samples.reserve(count); }
+
+    // Function to time one call
+    template <typename Call>
+    void measure(Call&& call) {
+        auto start = chrono::steady_clock::now();
+        call();
+        add(chrono::steady_clock::now() - start);
+    }
+
+    void add(chrono::steady_clock::duration elapsed) {
+        uint64_t nanos = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+        samples.push_back(static_cast<uint32_t>(min<uint64_t>(nanos, UINT32_MAX)));
+        totalNanos += nanos;
+    }
+
+    // Function to format the results; extraFields is inserted as is
+    string toJson(const string& extraFields = "") const {
+        vector<uint32_t> sorted(samples);
+        sort(sorted.begin(), sorted.end());
+        auto percentile = [&](double p) -> uint32_t {
+            return sorted.empty() ? 0 : sorted[min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+        };
+        double seconds = totalNanos * 1e-9;
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "{\"count\": %zu, \"seconds\": %.6f, \"ops_per_sec\": %.0f, \"p50_ns\": %u, \"p99_ns\": %u, "
+                 "\"p999_ns\": %u, \"max_ns\": %u",
+                 sorted.size(), seconds, seconds > 0 ? sorted.size() / seconds : 0.0, percentile(0.5),
+                 percentile(0.99), percentile(0.999), sorted.empty() ? 0 : sorted.back());
+        return buffer + extraFields + "}";
+    }
+};
+
+// Function to benchmark one library size and return the results as a JSON
+// object: bulk import of CSV exports, building the catalog with addBook, and
+// a Zipf-skewed circulation trace timing checkOutBook, checkInBook and
+// patronsOwingFees. Everything is generated from the seed, so runs repeat.
+string runBenchmark(size_t bookCount, size_t operationCount, uint64_t seed) {
+    const size_t patronCount = max<size_t>(bookCount / 10, 100);
+    const size_t authorCount = max<size_t>(bookCount / 20, 1);
+    const double skew = 1.0;
+    const char* tmpDir = getenv("TMPDIR") != nullptr ? getenv("TMPDIR") : "/tmp";
+    unsigned threads = max(thread::hardware_concurrency(), 1u);
+    auto owedFees = [](size_t patron) { return patron % 20 == 0 ? 5 : 0; }; // One patron in 20 starts owing
+    auto fail = [](const string& what) { return runtime_error(what + ": " + strerror(errno)); };
+
+    // Bulk import: write the exports, then time loading them
+    string booksPath = string(tmpDir) + "/library-bench-books-XXXXXX";
+    string patronsPath = string(tmpDir) + "/library-bench-patrons-XXXXXX";
+    int booksFd = mkstemp(&booksPath[0]);
+    if (booksFd < 0) throw fail("Cannot create " + booksPath);
+    int patronsFd = mkstemp(&patronsPath[0]);
+    if (patronsFd < 0) {
+        ::close(booksFd);
+        ::unlink(booksPath.c_str());
+        throw fail("Cannot create " + patronsPath);
+    }
+    double importSeconds;
+    try {
+        string buffer;
+        auto flush = [&buffer](int fd, bool force) {
+            if (force || buffer.size() > (1 << 20)) {
+                writeAll(fd, buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        };
+        buffer += "isbn,title,author,year,genre\n";
+        for (size_t i = 0; i < bookCount; ++i) {
+            buffer += syntheticIsbn(i) + "," + syntheticTitle(i) + "," + syntheticAuthor(i, authorCount) + "," +
+                      to_string(1900 + i % 125) + "," + to_string(i % genreCount) + "\n";
+            flush(booksFd, false);
+        }
+        flush(booksFd, true);
+        for (size_t i = 0; i < patronCount; ++i) {
+            buffer += "Patron " + to_string(i) + "\t" + syntheticCard(i) + "\t" + to_string(owedFees(i)) + "\n";
+            flush(patronsFd, false);
+        }
+        flush(patronsFd, true);
+        ::close(booksFd);
+        ::close(patronsFd);
+
+        Library imported;
+        auto start = chrono::steady_clock::now();
+        imported.importBooks(booksPath, threads);
+        imported.importPatrons(patronsPath, threads);
+        importSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } catch (...) {
+        ::unlink(booksPath.c_str());
+        ::unlink(patronsPath.c_str());
+        throw;
+    }
+    ::unlink(booksPath.c_str());
+    ::unlink(patronsPath.c_str());
+
+    // addBook: build the catalog one call at a time
+    Library library;
+    LatencySamples addBookSamples;
+    addBookSamples.reserve(bookCount);
+    for (size_t i = 0; i < bookCount; ++i) {
+        string isbn = syntheticIsbn(i), title = syntheticTitle(i), author = syntheticAuthor(i, authorCount);
+        Book book(isbn, title, author, 1900 + static_cast<int>(i % 125), static_cast<Genre>(i % genreCount));
+        addBookSamples.measure([&] { library.addBook(book); });
+    }
+    vector<string> cards(patronCount);
+    for (size_t i = 0; i < patronCount; ++i) {
+        cards[i] = syntheticCard(i);
+        string name = "Patron " + to_string(i);
+        library.addPatron(Patron(name, cards[i], owedFees(i)));
+    }
+
+    // Circulation trace: popular books and busy patrons come up far more often
+    mt19937_64 rng(seed);
+    ZipfGenerator bookRank(bookCount, skew), patronRank(patronCount, skew);
+    const size_t bookStride = scatterStride(bookCount), patronStride = scatterStride(patronCount);
+    const size_t operationsPerDay = max<size_t>(operationCount / 365, 1);
+    const size_t operationsPerReport = max<size_t>(operationCount / 1000, 1);
+    const string owesFeesMessage = circulationStatusToString(CirculationStatus::patronOwesFees);
+    int32_t day = dateToEpochDay("2024-01-01");
+    string date = epochDayToDate(day);
+    library.advanceClock(date);
+
+    LatencySamples checkOutSamples, checkInSamples, owingSamples;
+    checkOutSamples.reserve(operationCount);
+    checkInSamples.reserve(operationCount / 2);
+    deque<size_t> openLoans; // Books out on loan, oldest first
+    size_t rejected = 0;
+    for (size_t op = 0; op < operationCount; ++op) {
+        if (op > 0 && op % operationsPerDay == 0) {
+            date = epochDayToDate(++day);
+            library.advanceClock(date);
+        }
+        if (op % operationsPerReport == 0) {
+            owingSamples.measure([&] { library.patronsOwingFees(); });
+        }
+        if (!openLoans.empty() && (rng() & 1)) {
+            // Return the oldest loan
+            string isbn = syntheticIsbn(openLoans.front());
+            openLoans.pop_front();
+            checkInSamples.measure([&] { library.checkInBook(isbn, date); });
+            continue;
+        }
+        size_t book = bookRank(rng) * bookStride % bookCount;
+        size_t patron = patronRank(rng) * patronStride % patronCount;
+        string isbn = syntheticIsbn(book);
+        bool paid = false;
+        auto start = chrono::steady_clock::now();
+        try {
+            library.checkOutBook(isbn, cards[patron], date);
+            checkOutSamples.add(chrono::steady_clock::now() - start);
+            openLoans.push_back(book);
+        } catch (const runtime_error& e) {
+            checkOutSamples.add(chrono::steady_clock::now() - start);
+            ++rejected;
+            paid = e.what() == owesFeesMessage;
+        }
+        if (paid) library.setPatronFees(cards[patron], 0); // The patron pays up at the desk
+    }
+
+    char header[160];
+    snprintf(header, sizeof(header), "{\"books\": %zu, \"patrons\": %zu, \"operations\": %zu, \"zipf_exponent\": %.2f",
+             bookCount, patronCount, operationCount, skew);
+    char import[160];
+    snprintf(import, sizeof(import), "{\"records\": %zu, \"threads\": %u, \"seconds\": %.6f, \"records_per_sec\": %.0f}",
+             bookCount + patronCount, threads, importSeconds, (bookCount + patronCount) / importSeconds);
+    return string(header) + ",\n   \"bulkImport\": " + import +
+           ",\n   \"addBook\": " + addBookSamples.toJson() +
+           ",\n   \"checkOutBook\": " + checkOutSamples.toJson(", \"rejected\": " + to_string(rejected)) +
+           ",\n   \"checkInBook\": " + checkInSamples.toJson() +
+           ",\n   \"patronsOwingFees\": " + owingSamples.toJson(", \"owing\": " + to_string(library.patronsOwingFees().size())) +
+           "}";
+}
+
+// Main function where the program starts
+int main(int argc, char* argv[]) {
+    try {
+        // "--stress [desks] [journal]" runs the concurrent circulation stress test
+        // with 1, 2, 4 ... desks instead of the demo, journaling if a path is given
+        if (argc > 1 && string(argv[1]) == "--stress") {
+            unsigned desks = argc > 2 ? max(static_cast<unsigned>(stoul(argv[2])), 1u) : max(thread::hardware_concurrency(), 2u);
+            return runStressScaling(desks, argc > 3 ? argv[3] : "") == 0 ? 0 : 1;
+        }
+
+        // "--bench [sizes] [operations] [seed]" prints JSON benchmark results for each
+        // comma-separated catalog size (default 10000,100000,1000000)
+        if (argc > 1 && string(argv[1]) == "--bench") {
+            string sizes = argc > 2 ? argv[2] : "10000,100000,1000000";
+            size_t operations = argc > 3 ? stoul(argv[3]) : 1000000;
+            uint64_t seed = argc > 4 ? stoull(argv[4]) : 42;
+            cout << "{\"benchmark\": \"library\", \"seed\": " << seed << ", \"runs\": [";
+            size_t begin = 0;
+            for (bool first = true; begin <= sizes.size(); first = false) {
+                size_t end = min(sizes.find(',', begin), sizes.size());
+                size_t books = stoul(sizes.substr(begin, end - begin));
+                if (books == 0) throw runtime_error("Benchmark sizes must be positive.");
+                cout << (first ? "\n  " : ",\n  ") << runBenchmark(books, operations, seed) << flush;
+                begin = end + 1;
+            }
+            cout << "\n]}\n";
+            return 0;
+        }
+
+        // "--import books.csv patrons.csv [threads]" bulk-loads a catalog and patron export
+        if (argc > 3 && string(argv[1]) == "--import") {
+            unsigned threads = argc > 4 ? static_cast<unsigned>(stoul(argv[4])) : 1;
+            Library imported;
+            auto start = chrono::steady_clock::now();
+            size_t bookCount = imported.importBooks(argv[2], threads);
+            size_t patronCount = imported.importPatrons(argv[3], threads);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cout << "Imported " << bookCount << " books and " << patronCount << " patrons in "
+                 << seconds << " s (" << static_cast<long>((bookCount + patronCount) / seconds) << " records/s)\n";
+            return 0;
+        }
+
+        // "--save-snapshot books.csv patrons.csv library.snap" imports exports and saves them as a snapshot
+        if (argc > 4 && string(argv[1]) == "--save-snapshot") {
+            Library imported;
+            imported.importBooks(argv[2]);
+            imported.importPatrons(argv[3]);
+            auto start = chrono::steady_clock::now();
+            imported.saveSnapshot(argv[4]);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cout << "Saved " << imported.countBooks() << " books and " << imported.countPatrons() << " patrons in "
+                 << seconds << " s\n";
+            return 0;
+        }
+
+        // "--load-snapshot library.snap [--verify]" times how long a snapshot takes to become usable
+        if (argc > 2 && string(argv[1]) == "--load-snapshot") {
+            bool verify = argc > 3 && string(argv[3]) == "--verify";
+            Library loaded;
+            auto start = chrono::steady_clock::now();
+            loaded.loadSnapshot(argv[2], verify);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            cout << "Loaded " << loaded.countBooks() << " books and " << loaded.countPatrons() << " patrons in "
+                 << seconds * 1000 << " ms" << (verify ? " (checksums verified)" : "") << "\n";
+            cout << "Checked out: " << loaded.countCheckedOut() << ", owing fees: " << loaded.patronsOwingFees().size() << "\n";
+            return 0;
+        }
+
+        // Create a library instance
+        Library library;
+
+        // Add books to the library
+        library.addBook(Book("123", "C++ Primer", "Stanley Lippman", 2012, Genre::nonfiction));
+        library.addBook(Book("456", "The Great Gatsby", "F. Scott Fitzgerald", 1925, Genre::fiction));
+
+        // Add patrons to the library
+        library.addPatron(Patron("Alice", "001"));
+        library.addPatron(Patron("Bob", "002", 10)); // Bob owes fees
+
+        // Replay and keep a journal if one was given on the command line
+        if (argc > 1) {
+            library.openJournal(argv[1]);
+        }
+
+        // Attempt to check out a book (Alice checks out "C++ Primer")
+        library.checkOutBook("123", "001", "2024-11-25");
+
+        // List available fiction using the genre index
+        cout << "Available fiction:\n";
+        for (const Book& book : library.availableBooksInGenre(Genre::fiction)) {
+            cout << book.getTitle() << "\n";
+        }
+
+        // Alice returns the book late, and the clock moves past its due date
+        cout << "Late fine charged to Alice: " << library.checkInBook("123", "2024-12-20") << "\n";
+        library.setPatronFees("001", 0); // Alice pays her fine
+        // Alice takes two books through the self-checkout kiosk; one scan is not in the catalog
+        vector<string_view> kioskScans = { "456", "999" };
+        vector<CirculationStatus> kioskStatuses = library.checkOutBooks(kioskScans, "001", "2024-12-20");
+        for (size_t i = 0; i < kioskScans.size(); ++i) {
+            cout << "Kiosk " << kioskScans[i] << ": " << circulationStatusToString(kioskStatuses[i]) << "\n";
+        }
+        library.advanceClock("2025-01-15"); // "456" was due 2025-01-10, so Alice owes again
+
+        // Search the catalog by a fragment of a title
+        cout << "Search results for \"gats\":\n";
+        for (const Book& book : library.searchCatalog("gats")) {
+            cout << book.getTitle() << " by " << book.getAuthor() << "\n";
+        }
 
         // List patrons who owe fees
         auto owingPatrons = library.patronsOwingFees();
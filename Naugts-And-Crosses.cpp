@@ -1,113 +1,1231 @@
 #include <iostream>
 #include <vector> // dynamic array that can change size as needed.
+#include <string>
+#include <cstdint> // For the 64-bit board masks
+#include <stdexcept> // For rejecting unsupported board sizes
+#include <algorithm> // For ordering moves by how many lines they touch
+#include <chrono> // For the computer's time budget per move
+#include <cstring> // For checking the solved table's header
+#include <cerrno> // For errno set by system calls
+#include <fstream> // For writing the solved table
+#include <memory> // For the solver's workers
+#include <thread> // For solving on every core
+#include <mutex> // For the work-stealing deques
+#include <atomic> // For the shared transposition table and task outcomes
+#include <deque> // For each worker's tasks
+#include <array> // For the tournament's results by pairing
+#include <sstream> // For splitting the tournament's policy list
+#include <fcntl.h> // For opening the solved table
+#include <unistd.h> // For close
+#include <sys/stat.h> // For the size of the solved table
+#include <sys/mman.h> // For memory-mapping the solved table
 using namespace std;
 
+// GameRules Class: The geometry of an m x n board where k in a row wins (up
+// to 8 x 8, so a board fits in 64 bits). Cell r*columns + c is bit r*columns + c
+// of a player's mask. Every winning line is precomputed as a mask, and each
+// cell keeps the lines through it, so after a move only those few lines
+// need an AND and a compare.
+class GameRules {
+private:
+    int rowCount, columnCount, inRow;
+    uint64_t full;                   // Every cell
+    vector<uint64_t> allLines;       // Every k-in-a-row
+    vector<uint64_t> cellLines;      // Lines through each cell, cell by cell
+    vector<uint32_t> cellLineStart;  // Where each cell's lines begin in cellLines (cellCount() + 1 entries)
+    vector<vector<int>> cellMaps;    // Each symmetry of the board, as the cell every cell moves to
+    vector<vector<int>> inverseMaps; // Each symmetry undone
+    vector<int> orderedCells;        // Cells by how many lines pass through them, most first
+
+public:
+    static const int maxSide = 8;
+
+    GameRules(int rows = 3, int columns = 3, int k = 3) : rowCount(rows), columnCount(columns), inRow(k) {
+        if (rows < 1 || columns < 1 || rows > maxSide || columns > maxSide || k < 1 || k > max(rows, columns)) {
+            throw invalid_argument("Boards can be up to 8x8, with k no larger than the longer side.");
+        }
+        int cells = rows * columns;
+        full = cells == 64 ? ~uint64_t(0) : (uint64_t(1) << cells) - 1;
+
+        // Right, down, down-right and down-left from every cell where the line fits
+        const int directions[4][2] = { { 0, 1 }, { 1, 0 }, { 1, 1 }, { 1, -1 } };
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < columns; ++c) {
+                for (const auto& d : directions) {
+                    int endRow = r + d[0] * (k - 1), endColumn = c + d[1] * (k - 1);
+                    if (endRow >= rows || endColumn < 0 || endColumn >= columns) continue;
+                    if (k == 1 && &d != &directions[0]) continue; // A single cell is one line, not four
+                    uint64_t line = 0;
+                    for (int i = 0; i < k; ++i) line |= uint64_t(1) << ((r + d[0] * i) * columns + c + d[1] * i);
+                    allLines.push_back(line);
+                }
+            }
+        }
+        for (int cell = 0; cell < cells; ++cell) {
+            cellLineStart.push_back(static_cast<uint32_t>(cellLines.size()));
+            for (uint64_t line : allLines) {
+                if (line & (uint64_t(1) << cell)) cellLines.push_back(line);
+            }
+        }
+        cellLineStart.push_back(static_cast<uint32_t>(cellLines.size()));
+
+        // Rotations and reflections that map the board onto itself: all 8 on a
+        // square board, otherwise the identity, both flips and the half turn
+        for (int s = 0; s < (rows == columns ? 8 : 4); ++s) {
+            vector<int> map(cells);
+            for (int r = 0; r < rows; ++r) {
+                for (int c = 0; c < columns; ++c) {
+                    int mr = r, mc = c;
+                    if (s & 1) mc = columns - 1 - mc;          // Flip left-right
+                    if (s & 2) mr = rows - 1 - mr;             // Flip top-bottom
+                    if (s & 4) swap(mr, mc);                   // Transpose (square boards only)
+                    map[r * columns + c] = mr * columns + mc;
+                }
+            }
+            vector<int> inverse(cells);
+            for (int cell = 0; cell < cells; ++cell) inverse[map[cell]] = cell;
+            cellMaps.push_back(move(map));
+            inverseMaps.push_back(move(inverse));
+        }
+
+        for (int cell = 0; cell < cells; ++cell) orderedCells.push_back(cell);
+        stable_sort(orderedCells.begin(), orderedCells.end(),
+                    [&](int a, int b) { return linesThrough(a) > linesThrough(b); });
+    }
+
+    int rows() const { return rowCount; }
+    int columns() const { return columnCount; }
+    int k() const { return inRow; }
+    int cellCount() const { return rowCount * columnCount; }
+    uint64_t fullMask() const { return full; }
+    const vector<uint64_t>& lines() const { return allLines; }
+    const vector<vector<int>>& symmetries() const { return cellMaps; }
+    const vector<vector<int>>& inverseSymmetries() const { return inverseMaps; }
+    const vector<int>& cellsByLines() const { return orderedCells; }
+    int linesThrough(int cell) const { return static_cast<int>(cellLineStart[cell + 1] - cellLineStart[cell]); }
+
+    // Function to check whether the move at cell completed a line for the player owning marks
+    bool winsAt(uint64_t marks, int cell) const {
+        for (uint32_t i = cellLineStart[cell]; i < cellLineStart[cell + 1]; ++i) {
+            if ((marks & cellLines[i]) == cellLines[i]) return true;
+        }
+        return false;
+    }
+
+    // Function to check whether marks hold any line (when the last move is not known)
+    bool wins(uint64_t marks) const {
+        for (uint64_t line : allLines) {
+            if ((marks & line) == line) return true;
+        }
+        return false;
+    }
+
+    bool isFull(uint64_t occupied) const { return occupied == full; }
+};
+
+// Board Structure: One bitmask per player, X first. X always starts, so
+// the player to move follows from how many cells are taken.
+struct Board {
+    uint64_t marks[2] = { 0, 0 };
+
+    uint64_t occupied() const { return marks[0] | marks[1]; }
+    int toMove() const { return __builtin_popcountll(occupied()) & 1; } // 0 for X, 1 for O
+    bool isEmpty(int cell) const { return !(occupied() & (uint64_t(1) << cell)); }
+    void play(int cell) { marks[toMove()] |= uint64_t(1) << cell; }
+};
+
+// ZobristKeys Structure: A fixed random 64-bit key for each player's mark on
+// each cell, the same on every run so that saved tables stay valid.
+struct ZobristKeys {
+    uint64_t key[2][64];
+
+    ZobristKeys() {
+        uint64_t seed = 0x2545f4914f6cdd1dull;
+        for (auto& player : key) {
+            for (uint64_t& k : player) {
+                // SplitMix64
+                seed += 0x9e3779b97f4a7c15ull;
+                uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+                k = z ^ (z >> 31);
+            }
+        }
+    }
+};
+static const ZobristKeys zobrist;
+
+// PositionHash Structure: The Zobrist hash of a board under each of its
+// symmetries, kept up to date one mark at a time. The smallest of them is
+// the canonical hash, the same for every rotation and reflection of the
+// position.
+struct PositionHash {
+    uint64_t hashes[8] = {};
+
+    void set(const GameRules& rules, const Board& board) {
+        for (size_t s = 0; s < rules.symmetries().size(); ++s) {
+            hashes[s] = 0;
+            for (int player = 0; player < 2; ++player) {
+                for (uint64_t m = board.marks[player]; m != 0; m &= m - 1) {
+                    hashes[s] ^= zobrist.key[player][rules.symmetries()[s][__builtin_ctzll(m)]];
+                }
+            }
+        }
+    }
+
+    void toggle(const GameRules& rules, int player, int cell) {
+        for (size_t s = 0; s < rules.symmetries().size(); ++s) hashes[s] ^= zobrist.key[player][rules.symmetries()[s][cell]];
+    }
+
+    // Function to find the canonical hash (never 0, which marks an empty entry) and the symmetry giving it
+    uint64_t canonical(const GameRules& rules, size_t& symmetry) const {
+        symmetry = 0;
+        for (size_t s = 1; s < rules.symmetries().size(); ++s) {
+            if (hashes[s] < hashes[symmetry]) symmetry = s;
+        }
+        return hashes[symmetry] | 1;
+    }
+};
+
+// SolvedTable Class: Positions worked out by the parallel solver, read from
+// a file mapped into memory. Each position is one 64-bit word: its
+// canonical hash with the low 4 bits replaced by the lowest and highest
+// outcome (-1 loss, 0 draw, 1 win, each plus 1) the player to move can
+// get. The words are sorted, so a lookup is a binary search and nothing
+// is read until it is needed.
+class SolvedTable {
+public:
+    // Structure at the start of the file, followed by count words
+    struct Header {
+        char magic[8];
+        uint8_t rows, columns, k, unused[5];
+        uint64_t count;
+    };
+    static constexpr char magicText[8] = "NCSOLV1";
+    static const int unknownOutcome = 2; // Not worked out yet
+
+    static uint64_t pack(uint64_t key, int lowest, int highest) {
+        return (key & ~uint64_t(15)) | uint64_t(lowest + 1) | uint64_t(highest + 1) << 2;
+    }
+
+private:
+    const uint64_t* words = nullptr;
+    size_t count = 0;
+    void* mapped = nullptr;
+    size_t mappedSize = 0;
+
+public:
+    SolvedTable(const string& path, const GameRules& rules) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw runtime_error("Cannot open table " + path + ": " + strerror(errno));
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw runtime_error("Cannot read table " + path + ": " + strerror(errno));
+        }
+        mappedSize = static_cast<size_t>(info.st_size);
+        if (mappedSize < sizeof(Header)) {
+            close(fd);
+            throw runtime_error("Table " + path + " is too short");
+        }
+        mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) throw runtime_error("Cannot map table " + path + ": " + strerror(errno));
+        const Header* header = static_cast<const Header*>(mapped);
+        count = static_cast<size_t>(header->count);
+        if (memcmp(header->magic, magicText, sizeof(magicText)) != 0 ||
+            count > (mappedSize - sizeof(Header)) / sizeof(uint64_t)) {
+            munmap(mapped, mappedSize);
+            throw runtime_error(path + " is not a solved-position table");
+        }
+        if (header->rows != rules.rows() || header->columns != rules.columns() || header->k != rules.k()) {
+            munmap(mapped, mappedSize);
+            throw runtime_error("Table " + path + " was solved for " + to_string(header->rows) + "x" +
+                                to_string(header->columns) + " k=" + to_string(header->k));
+        }
+        words = reinterpret_cast<const uint64_t*>(static_cast<const char*>(mapped) + sizeof(Header));
+    }
+
+    SolvedTable(const SolvedTable&) = delete;
+    SolvedTable& operator=(const SolvedTable&) = delete;
+
+    ~SolvedTable() { munmap(mapped, mappedSize); }
+
+    size_t size() const { return count; }
+
+    // Function to find the outcomes of a position by its canonical hash; false if it is not in the table
+    bool find(uint64_t key, int& lowest, int& highest) const {
+        uint64_t wanted = key & ~uint64_t(15);
+        const uint64_t* found = lower_bound(words, words + count, wanted);
+        if (found == words + count || (*found & ~uint64_t(15)) != wanted) return false;
+        lowest = static_cast<int>(*found & 3) - 1;
+        highest = static_cast<int>(*found >> 2 & 3) - 1;
+        return true;
+    }
+};
+
+// ComputerPlayer Class: Chooses moves by negamax search with alpha-beta
+// pruning. Moves are tried best-first: the move remembered for the
+// position, then immediate wins, then cells on the most lines. Results are
+// kept in a transposition table keyed by a Zobrist hash, taken as the
+// smallest hash over the board's symmetries so that rotated and reflected
+// positions share one entry. Search deepens one ply at a time until the
+// game is solved or the time budget runs out; unfinished positions are
+// scored by the lines each player can still complete. The table is kept
+// between moves and games, so later searches start warm.
+class ComputerPlayer {
+public:
+    static const int winScore = 10000; // A win is worth winScore minus the marks on the board when it happens
+
+    // Structure for what the last search did
+    struct SearchInfo {
+        int move = -1;        // Cell chosen
+        int score = 0;        // From the mover's point of view
+        int depth = 0;        // Deepest search completed
+        bool solved = false;  // Whether the score is exact (searched to the end of the game)
+        uint64_t nodes = 0;   // Positions visited
+        double seconds = 0;
+    };
+
+private:
+    // Structure for one transposition table entry
+    struct Entry {
+        uint64_t key = 0;     // Canonical hash (0 when empty)
+        int16_t score = 0;
+        int8_t depth = -1;    // Plies searched below this position
+        uint8_t bound = 0;    // exact, lower or upper
+        int8_t move = -1;     // Best move, in the canonical orientation
+    };
+    static const uint8_t exact = 0, lower = 1, upper = 2;
+
+    const GameRules& rules;
+    vector<Entry> table;              // Size is a power of two
+    PositionHash hash;                // Of the position being searched
+    const SolvedTable* solved = nullptr;
+    uint64_t nodes = 0;
+    chrono::steady_clock::time_point deadline;
+    bool timeUp = false;
+    int rootMove = -1;
+
+public:
+    explicit ComputerPlayer(const GameRules& gameRules, size_t tableBits = 20)
+        : rules(gameRules), table(size_t(1) << tableBits) {}
+
+    // Function to play straight from a solved table wherever it proves a move best
+    void useTable(const SolvedTable* solvedTable) { solved = solvedTable; }
+
+    // Function to choose a move for the player to move, searching for at most seconds and maxDepth plies
+    SearchInfo chooseMove(const Board& start, double seconds, int maxDepth = 64) {
+        auto began = chrono::steady_clock::now();
+        deadline = began + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(seconds));
+        timeUp = false;
+        nodes = 0;
+        Board board = start;
+        hash.set(rules, board);
+        SearchInfo info;
+        if (solved != nullptr && playFromTable(board, info)) {
+            info.seconds = chrono::duration<double>(chrono::steady_clock::now() - began).count();
+            return info;
+        }
+        int empty = rules.cellCount() - __builtin_popcountll(board.occupied());
+
+        for (int depth = 1; depth <= min(empty, maxDepth); ++depth) {
+            rootMove = -1;
+            int score = negamax(board, depth, -winScore - 1, winScore + 1, -1, true);
+            if (timeUp) break; // Keep the last complete iteration
+            info.move = rootMove;
+            info.score = score;
+            info.depth = depth;
+            // The game ends within the depth searched: the result is exact
+            info.solved = depth == empty || abs(score) > winScore - 64;
+            if (info.solved) break;
+        }
+        if (info.move < 0) { // Not even one ply finished: take the best-ordered free cell
+            for (int cell : rules.cellsByLines()) {
+                if (board.isEmpty(cell)) {
+                    info.move = cell;
+                    break;
+                }
+            }
+        }
+        info.nodes = nodes;
+        info.seconds = chrono::duration<double>(chrono::steady_clock::now() - began).count();
+        return info;
+    }
+
+private:
+    // Function to take the move the solved table says is best, if it can tell
+    bool playFromTable(const Board& board, SearchInfo& info) {
+        int mover = board.toMove();
+        size_t symmetry;
+        int lowest = -1, highest = 1;
+        bool known = solved->find(hash.canonical(rules, symmetry), lowest, highest);
+        int best = -2, bestMove = -1;
+        for (int cell : rules.cellsByLines()) {
+            if (!board.isEmpty(cell)) continue;
+            uint64_t after = board.marks[mover] | (uint64_t(1) << cell);
+            int guaranteed; // The least the move is known to get
+            if (rules.winsAt(after, cell)) {
+                guaranteed = 1;
+            } else if (rules.isFull(after | board.marks[mover ^ 1])) {
+                guaranteed = 0;
+            } else {
+                int childLowest, childHighest;
+                hash.toggle(rules, mover, cell);
+                guaranteed = solved->find(hash.canonical(rules, symmetry), childLowest, childHighest) ? -childHighest : -1;
+                hash.toggle(rules, mover, cell);
+            }
+            if (guaranteed > best) {
+                best = guaranteed;
+                bestMove = cell;
+            }
+        }
+        // Best means nothing can do better: a win, or all the position is worth
+        if (bestMove < 0 || (best < 1 && !(known && best >= highest))) return false;
+        info.move = bestMove;
+        info.score = best;
+        info.solved = true;
+        return true;
+    }
+
+    // Function to score a position that is not searched further: each line
+    // still open to only one player counts for that player, more the fuller it is
+    int evaluate(const Board& board) const {
+        int mover = board.toMove();
+        int score = 0;
+        for (uint64_t line : rules.lines()) {
+            int mine = __builtin_popcountll(line & board.marks[mover]);
+            int theirs = __builtin_popcountll(line & board.marks[mover ^ 1]);
+            if (theirs == 0) score += mine * mine;
+            if (mine == 0) score -= theirs * theirs;
+        }
+        return max(-winScore / 2, min(winScore / 2, score));
+    }
+
+    int negamax(Board& board, int depth, int alpha, int beta, int lastCell, bool root) {
+        if ((++nodes & 4095) == 0 && chrono::steady_clock::now() > deadline) timeUp = true;
+        if (timeUp) return 0;
+        int mover = board.toMove();
+        int marks = __builtin_popcountll(board.occupied());
+        if (lastCell >= 0 && rules.winsAt(board.marks[mover ^ 1], lastCell)) return -(winScore - marks);
+        if (rules.isFull(board.occupied())) return 0;
+        if (depth == 0) return evaluate(board);
+
+        size_t symmetry;
+        uint64_t key = hash.canonical(rules, symmetry);
+        Entry& entry = table[key & (table.size() - 1)];
+        int remembered = -1;
+        if (entry.key == key) {
+            if (entry.move >= 0) remembered = rules.inverseSymmetries()[symmetry][entry.move];
+            if (entry.depth >= depth && (!root || (entry.bound == exact && remembered >= 0))) {
+                if (root) rootMove = remembered; // The search needs a move here, not just a score
+                if (entry.bound == exact) return entry.score;
+                if (entry.bound == lower && entry.score >= beta) return entry.score;
+                if (entry.bound == upper && entry.score <= alpha) return entry.score;
+            }
+        }
+
+        // Order the moves: remembered best, then wins, then the rest by lines through the cell
+        int moves[64], count = 0;
+        if (remembered >= 0 && board.isEmpty(remembered)) moves[count++] = remembered;
+        int firstOrdinary = count;
+        for (int cell : rules.cellsByLines()) {
+            if (!board.isEmpty(cell) || cell == remembered) continue;
+            moves[count++] = cell;
+            if (rules.winsAt(board.marks[mover] | (uint64_t(1) << cell), cell)) {
+                swap(moves[firstOrdinary++], moves[count - 1]);
+            }
+        }
+
+        int originalAlpha = alpha;
+        int best = -winScore - 1, bestMove = -1;
+        for (int i = 0; i < count; ++i) {
+            int cell = moves[i];
+            board.marks[mover] |= uint64_t(1) << cell;
+            hash.toggle(rules, mover, cell);
+            int score = -negamax(board, depth - 1, -beta, -alpha, cell, false);
+            hash.toggle(rules, mover, cell);
+            board.marks[mover] &= ~(uint64_t(1) << cell);
+            if (timeUp) return 0;
+            if (score > best) {
+                best = score;
+                bestMove = cell;
+            }
+            alpha = max(alpha, score);
+            if (alpha >= beta) break;
+        }
+        if (root) rootMove = bestMove;
+
+        int empty = rules.cellCount() - marks;
+        if (depth >= entry.depth || entry.key != key) { // Keep the deeper result when slots collide
+            entry.key = key;
+            entry.score = static_cast<int16_t>(best);
+            entry.depth = static_cast<int8_t>(min(depth, empty));
+            entry.bound = best <= originalAlpha ? upper : best >= beta ? lower : exact;
+            entry.move = static_cast<int8_t>(rules.symmetries()[symmetry][bestMove]);
+        }
+        return best;
+    }
+};
+
+// ParallelSolver Class: Works out whether the player to move wins, draws or
+// loses with best play on both sides, using every core. The top splitDepth
+// plies of the tree become tasks on a work-stealing pool: a worker pops
+// tasks from the back of its own deque and, when that runs dry, steals from
+// the front of another's. Below that, a task is searched by one worker with
+// alpha-beta over the three outcomes, in a window narrowed by what its
+// siblings have already found. A child that loses settles its parent as a
+// win at once, and the siblings still queued or running are abandoned.
+// Workers share one lock-free transposition table: a slot holds its data
+// word and the key XORed with that word, so a slot torn by two writers
+// fails its check instead of handing out another position's bounds.
+class ParallelSolver {
+public:
+    // Structure for what one solve did
+    struct Result {
+        int outcome = 0;      // For the player to move: -1 loss, 0 draw, 1 win
+        uint64_t nodes = 0;   // Positions searched, over all workers
+        double seconds = 0;
+    };
+
+private:
+    // Structure for one shared table slot. Data holds the lowest and highest
+    // outcome (each plus 1) in bits 0-3, the best move in the canonical
+    // orientation in bits 8-15 and log2 of the nodes searched below in bits 16-23.
+    struct Slot {
+        atomic<uint64_t> check{0}, data{0};
+    };
+
+    // Structure for a position in the split part of the tree
+    struct Task {
+        Board board;
+        int lastCell = -1;
+        int ply = 0;
+        Task* parent = nullptr;
+        atomic<int> pending{0};      // Children yet to report
+        atomic<int> best{-2};        // Best outcome found so far, for the player to move
+        atomic<bool> settled{false}; // Outcome known (and reported to the parent)
+    };
+
+    // Structure for one thread's share of the work
+    struct Worker {
+        mutex lock;                  // Guards queue: the owner and thieves both take from it
+        deque<Task*> queue;
+        deque<Task> tasks;           // Storage for the tasks this worker created
+        uint64_t nodes = 0;
+        Task* current = nullptr;
+        bool abandoned = false;      // current's outcome is no longer needed
+    };
+
+    const GameRules& rules;
+    vector<Slot> table;              // Pairs of slots: the first keeps the bigger search, the second the newest
+    vector<unique_ptr<Worker>> workers;
+    int splitDepth = 0;
+    atomic<bool> done{false};
+    atomic<int> rootOutcome{0};
+
+public:
+    // Constructor with a table of 2^tableBits slots, or sized for the board if tableBits is 0
+    explicit ParallelSolver(const GameRules& gameRules, size_t tableBits = 0)
+        : rules(gameRules), table(size_t(1) << (tableBits != 0 ? tableBits : tableBitsFor(gameRules))) {}
+
+    // Function to pick a table size for a board: twice the 3^cells positions
+    // it can have (log2 3 is about 1.585), between 2^10 and 2^24 slots
+    static size_t tableBitsFor(const GameRules& rules) {
+        size_t bits = static_cast<size_t>(rules.cellCount()) * 1585 / 1000 + 2;
+        return min<size_t>(max<size_t>(bits, 10), 24);
+    }
+
+    size_t tableSlots() const { return table.size(); }
+    size_t tableBytes() const { return table.size() * sizeof(Slot); }
+
+    // Function to forget everything solved so far
+    void clear() {
+        for (Slot& slot : table) {
+            slot.check.store(0, memory_order_relaxed);
+            slot.data.store(0, memory_order_relaxed);
+        }
+    }
+
+    // Function to solve a position on threads threads, splitting the first splitPlies plies into tasks
+    Result solve(const Board& start, unsigned threads, int splitPlies = 3) {
+        auto began = chrono::steady_clock::now();
+        splitDepth = splitPlies;
+        done = false;
+        workers.clear();
+        for (unsigned i = 0; i < max(threads, 1u); ++i) workers.push_back(make_unique<Worker>());
+        Task& root = workers[0]->tasks.emplace_back();
+        root.board = start;
+        workers[0]->queue.push_back(&root);
+
+        vector<thread> pool;
+        for (size_t i = 1; i < workers.size(); ++i) pool.emplace_back([this, i] { work(i); });
+        work(0);
+        for (thread& t : pool) t.join();
+
+        Result result;
+        result.outcome = rootOutcome;
+        for (const auto& worker : workers) result.nodes += worker->nodes;
+        workers.clear();
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - began).count();
+        return result;
+    }
+
+    // Function to save every position whose outcome the table narrows down, sorted for SolvedTable
+    size_t save(const string& path) const {
+        vector<uint64_t> words;
+        for (const Slot& slot : table) {
+            uint64_t data = slot.data.load(memory_order_relaxed);
+            if (data == 0 || (data & 15) == (0 | 2 << 2)) continue; // Empty, or nothing known
+            words.push_back(SolvedTable::pack(slot.check.load(memory_order_relaxed) ^ data,
+                                              static_cast<int>(data & 3) - 1, static_cast<int>(data >> 2 & 3) - 1));
+        }
+        sort(words.begin(), words.end());
+        words.erase(unique(words.begin(), words.end(), [](uint64_t a, uint64_t b) { return (a ^ b) < 16; }), words.end());
+
+        SolvedTable::Header header = {};
+        memcpy(header.magic, SolvedTable::magicText, sizeof(header.magic));
+        header.rows = static_cast<uint8_t>(rules.rows());
+        header.columns = static_cast<uint8_t>(rules.columns());
+        header.k = static_cast<uint8_t>(rules.k());
+        header.count = words.size();
+        ofstream file(path, ios::binary | ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(words.data()), static_cast<streamsize>(words.size() * sizeof(uint64_t)));
+        if (!file.flush()) throw runtime_error("Cannot write table " + path);
+        return words.size();
+    }
+
+private:
+    // Function to run one worker until the root is settled
+    void work(size_t self) {
+        Worker& worker = *workers[self];
+        while (!done.load(memory_order_acquire)) {
+            Task* task = nullptr;
+            {
+                lock_guard<mutex> guard(worker.lock);
+                if (!worker.queue.empty()) {
+                    task = worker.queue.back();
+                    worker.queue.pop_back();
+                }
+            }
+            for (size_t i = 1; task == nullptr && i < workers.size(); ++i) {
+                Worker& victim = *workers[(self + i) % workers.size()];
+                lock_guard<mutex> guard(victim.lock);
+                if (!victim.queue.empty()) {
+                    task = victim.queue.front(); // The oldest tasks are the biggest
+                    victim.queue.pop_front();
+                }
+            }
+            if (task == nullptr) {
+                this_thread::yield();
+                continue;
+            }
+            run(worker, *task);
+        }
+    }
+
+    static bool isAbandoned(const Task* task) {
+        for (const Task* t = task->parent; t != nullptr; t = t->parent) {
+            if (t->settled.load(memory_order_relaxed)) return true;
+        }
+        return false;
+    }
+
+    // Function to settle one split position, or to split it further
+    void run(Worker& worker, Task& task) {
+        if (isAbandoned(&task)) return;
+        auto settleHere = [&](int outcome) {
+            ++worker.nodes;
+            report(task, outcome);
+        };
+        Board& board = task.board;
+        int mover = board.toMove();
+        if (task.lastCell >= 0 && rules.winsAt(board.marks[mover ^ 1], task.lastCell)) return settleHere(-1);
+        if (rules.isFull(board.occupied())) return settleHere(0);
+        uint64_t moves;
+        int forced = forcedOutcome(board, moves);
+        if (forced != SolvedTable::unknownOutcome) return settleHere(forced);
+
+        PositionHash hash;
+        hash.set(rules, board);
+        if (task.ply >= splitDepth) { // search counts this position among its nodes
+            // Only a result that beats what the parent already has matters
+            int parentBest = task.parent != nullptr ? task.parent->best.load(memory_order_relaxed) : -2;
+            worker.current = &task;
+            worker.abandoned = false;
+            int outcome = search(worker, board, hash, -1, min(1, -parentBest));
+            if (!worker.abandoned) report(task, outcome);
+            return;
+        }
+
+        // One child for each different position: symmetric moves lead to the same one
+        ++worker.nodes;
+        vector<uint64_t> seen;
+        vector<int> children;
+        for (int cell : rules.cellsByLines()) {
+            if (!(moves >> cell & 1)) continue;
+            size_t symmetry;
+            hash.toggle(rules, mover, cell);
+            uint64_t key = hash.canonical(rules, symmetry);
+            hash.toggle(rules, mover, cell);
+            if (find(seen.begin(), seen.end(), key) != seen.end()) continue;
+            seen.push_back(key);
+            children.push_back(cell);
+        }
+        task.pending.store(static_cast<int>(children.size()), memory_order_relaxed);
+        lock_guard<mutex> guard(worker.lock);
+        for (auto cell = children.rbegin(); cell != children.rend(); ++cell) { // Best-ordered move comes off the back first
+            Task& child = worker.tasks.emplace_back();
+            child.board = board;
+            child.board.marks[mover] |= uint64_t(1) << *cell;
+            child.lastCell = *cell;
+            child.ply = task.ply + 1;
+            child.parent = &task;
+            worker.queue.push_back(&child);
+        }
+    }
+
+    // Function to pass a task's outcome up the split tree
+    void report(Task& task, int outcome) {
+        Task* parent = task.parent;
+        if (parent == nullptr) {
+            rootOutcome = outcome;
+            done.store(true, memory_order_release);
+            return;
+        }
+        int value = -outcome;
+        int best = parent->best.load(memory_order_relaxed);
+        while (value > best && !parent->best.compare_exchange_weak(best, value, memory_order_relaxed)) {}
+        if (value == 1) { // The parent can do no better
+            if (!parent->settled.exchange(true)) settle(*parent, 1);
+        } else if (parent->pending.fetch_sub(1, memory_order_acq_rel) == 1) {
+            if (!parent->settled.exchange(true)) settle(*parent, parent->best.load(memory_order_relaxed));
+        }
+    }
+
+    // Function to record a split position's outcome, exact once all its children are in, and pass it up
+    void settle(Task& task, int outcome) {
+        PositionHash hash;
+        hash.set(rules, task.board);
+        store(hash, outcome, outcome, -1, 63);
+        report(task, outcome);
+    }
+
+    // Function to settle a position without searching it when it can: a win
+    // now, or two of the opponent's wins to block. Otherwise leaves the moves
+    // worth trying (just the block, if there is one threat) in moves.
+    int forcedOutcome(const Board& board, uint64_t& moves) const {
+        int mover = board.toMove();
+        uint64_t empty = ~board.occupied() & rules.fullMask();
+        uint64_t threats = 0;
+        for (uint64_t m = empty; m != 0; m &= m - 1) {
+            int cell = __builtin_ctzll(m);
+            uint64_t bit = uint64_t(1) << cell;
+            if (rules.winsAt(board.marks[mover] | bit, cell)) return 1;
+            if (rules.winsAt(board.marks[mover ^ 1] | bit, cell)) threats |= bit;
+        }
+        if (__builtin_popcountll(threats) > 1) return -1;
+        moves = threats != 0 ? threats : empty;
+        return SolvedTable::unknownOutcome;
+    }
+
+    // Function to read a position's bounds from the shared table; false if it is not there
+    bool probe(uint64_t key, int& lowest, int& highest, int& move) const {
+        size_t index = key & (table.size() - 2);
+        for (size_t i = index; i < index + 2; ++i) {
+            uint64_t data = table[i].data.load(memory_order_relaxed);
+            if ((table[i].check.load(memory_order_relaxed) ^ data) != key || data == 0) continue;
+            lowest = static_cast<int>(data & 3) - 1;
+            highest = static_cast<int>(data >> 2 & 3) - 1;
+            move = static_cast<int>(data >> 8 & 255);
+            return true;
+        }
+        return false;
+    }
+
+    // Function to record what a search proved, adding to what the table already knows
+    void store(const PositionHash& hash, int lowest, int highest, int move, int effort) {
+        size_t symmetry;
+        uint64_t key = hash.canonical(rules, symmetry);
+        size_t index = key & (table.size() - 2);
+        int known, knownHighest, knownMove;
+        if (probe(key, known, knownHighest, knownMove)) {
+            lowest = max(lowest, known);
+            highest = min(highest, knownHighest);
+            if (move < 0) move = knownMove == 255 ? -1 : rules.inverseSymmetries()[symmetry][knownMove];
+        }
+        uint64_t data = uint64_t(lowest + 1) | uint64_t(highest + 1) << 2 |
+                        uint64_t(move < 0 ? 255 : rules.symmetries()[symmetry][move]) << 8 | uint64_t(effort) << 16;
+        Slot* slot = &table[index + 1];
+        uint64_t first = table[index].data.load(memory_order_relaxed);
+        if ((table[index].check.load(memory_order_relaxed) ^ first) == key || static_cast<int>(first >> 16 & 255) <= effort) {
+            slot = &table[index];
+        }
+        slot->data.store(data, memory_order_relaxed);
+        slot->check.store(key ^ data, memory_order_relaxed);
+    }
+
+    // Function to search one position to the end of the game, returning its
+    // outcome if it lies strictly inside (alpha, beta), or a bound beyond it
+    int search(Worker& worker, Board& board, PositionHash& hash, int alpha, int beta) {
+        if ((++worker.nodes & 4095) == 0 && isAbandoned(worker.current)) worker.abandoned = true;
+        if (worker.abandoned) return 0;
+        uint64_t moves;
+        int forced = forcedOutcome(board, moves);
+        if (forced != SolvedTable::unknownOutcome) return forced;
+
+        size_t symmetry;
+        uint64_t key = hash.canonical(rules, symmetry);
+        int lowest, highest, remembered = -1;
+        if (probe(key, lowest, highest, remembered)) {
+            if (lowest >= beta || lowest == highest) return lowest;
+            if (highest <= alpha) return highest;
+            alpha = max(alpha, lowest);
+            beta = min(beta, highest);
+            remembered = remembered == 255 ? -1 : rules.inverseSymmetries()[symmetry][remembered];
+        }
+
+        int mover = board.toMove();
+        uint64_t nodesBefore = worker.nodes;
+        int originalAlpha = alpha;
+        int best = -2, bestMove = -1;
+        auto tryMove = [&](int cell) {
+            board.marks[mover] |= uint64_t(1) << cell;
+            int outcome = 0; // A full board with no line is a draw
+            if (!rules.isFull(board.occupied())) {
+                hash.toggle(rules, mover, cell);
+                outcome = -search(worker, board, hash, -beta, -alpha);
+                hash.toggle(rules, mover, cell);
+            }
+            board.marks[mover] &= ~(uint64_t(1) << cell);
+            if (outcome > best) {
+                best = outcome;
+                bestMove = cell;
+            }
+            alpha = max(alpha, outcome);
+            return alpha >= beta || worker.abandoned;
+        };
+        bool cut = remembered >= 0 && (moves >> remembered & 1) && tryMove(remembered);
+        for (size_t i = 0; !cut && i < rules.cellsByLines().size(); ++i) {
+            int cell = rules.cellsByLines()[i];
+            if ((moves >> cell & 1) && cell != remembered) cut = tryMove(cell);
+        }
+        if (worker.abandoned) return 0;
+
+        int effort = 63 - __builtin_clzll(worker.nodes - nodesBefore + 1);
+        if (best <= originalAlpha) store(hash, -1, best, bestMove, effort);
+        else if (best >= beta) store(hash, best, 1, bestMove, effort);
+        else store(hash, best, best, bestMove, effort);
+        return best;
+    }
+};
+
+// FastRandom Class: Small, fast generator (xoshiro256**) for the
+// tournament's random players. below(n) draws without the bias of rand() % n.
+class FastRandom {
+private:
+    uint64_t state[4];
+
+    static uint64_t rotate(uint64_t x, int bits) { return (x << bits) | (x >> (64 - bits)); }
+
+public:
+    explicit FastRandom(uint64_t seed) {
+        for (uint64_t& word : state) {
+            // SplitMix64 spreads the seed over the whole state
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotate(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotate(state[3], 45);
+        return result;
+    }
+
+    // Function to draw uniformly from 0 .. n-1 (Lemire's multiply-and-reject)
+    uint64_t below(uint64_t n) {
+        unsigned __int128 product = static_cast<unsigned __int128>(next()) * n;
+        if (static_cast<uint64_t>(product) < n) {
+            uint64_t threshold = -n % n;
+            while (static_cast<uint64_t>(product) < threshold) product = static_cast<unsigned __int128>(next()) * n;
+        }
+        return static_cast<uint64_t>(product >> 64);
+    }
+
+    // Function to pick one set bit of mask (which must not be 0) uniformly
+    int pick(uint64_t mask) {
+        for (uint64_t skip = below(__builtin_popcountll(mask)); skip > 0; --skip) mask &= mask - 1;
+        return __builtin_ctzll(mask);
+    }
+};
+
+// Policy Class: Interface for a computer player in the tournament.
+// chooseMove() picks an empty cell for the player to move.
+class Policy {
+public:
+    virtual ~Policy() = default;
+    virtual int chooseMove(const Board& board) = 0;
+};
+
+// RandomPolicy Class: Plays any empty cell, as a baseline
+class RandomPolicy : public Policy {
+private:
+    const GameRules& rules;
+    FastRandom random;
+
+public:
+    RandomPolicy(const GameRules& gameRules, uint64_t seed) : rules(gameRules), random(seed) {}
+    int chooseMove(const Board& board) override { return random.pick(~board.occupied() & rules.fullMask()); }
+};
+
+// HeuristicPolicy Class: Wins if it can, blocks if it must, and otherwise
+// plays the cell whose lines are worth most to either player: a line open to
+// just one player counts 4^(marks in it). Ties are broken at random.
+class HeuristicPolicy : public Policy {
+private:
+    const GameRules& rules;
+    FastRandom random;
+
+public:
+    HeuristicPolicy(const GameRules& gameRules, uint64_t seed) : rules(gameRules), random(seed) {}
+
+    int chooseMove(const Board& board) override {
+        int mover = board.toMove();
+        uint64_t empty = ~board.occupied() & rules.fullMask();
+        uint64_t blocks = 0, best = 0;
+        long bestScore = -1;
+        for (uint64_t m = empty; m != 0; m &= m - 1) {
+            int cell = __builtin_ctzll(m);
+            uint64_t bit = uint64_t(1) << cell;
+            if (rules.winsAt(board.marks[mover] | bit, cell)) return cell;
+            if (rules.winsAt(board.marks[mover ^ 1] | bit, cell)) blocks |= bit;
+            long score = 0;
+            for (uint64_t line : rules.lines()) {
+                if (!(line & bit)) continue;
+                uint64_t mine = line & board.marks[mover], theirs = line & board.marks[mover ^ 1];
+                if (theirs == 0) score += 1L << (2 * __builtin_popcountll(mine));
+                if (mine == 0) score += 1L << (2 * __builtin_popcountll(theirs));
+            }
+            if (score > bestScore) {
+                bestScore = score;
+                best = 0;
+            }
+            if (score == bestScore) best |= bit;
+        }
+        return random.pick(blocks != 0 ? blocks : best);
+    }
+};
+
+// SearchPolicy Class: Plays the ComputerPlayer's choice, searching at most
+// maxDepth plies (and seconds) a move
+class SearchPolicy : public Policy {
+private:
+    ComputerPlayer computer;
+    double seconds;
+    int maxDepth;
+
+public:
+    SearchPolicy(const GameRules& rules, double moveSeconds, int depth)
+        : computer(rules, 16), seconds(moveSeconds), maxDepth(depth) {}
+    int chooseMove(const Board& board) override { return computer.chooseMove(board, seconds, maxDepth).move; }
+};
+
+// Function to create a policy by name: random, heuristic or search
+unique_ptr<Policy> makePolicy(const string& name, const GameRules& rules, uint64_t seed, double seconds, int maxDepth) {
+    if (name == "random") return make_unique<RandomPolicy>(rules, seed);
+    if (name == "heuristic") return make_unique<HeuristicPolicy>(rules, seed);
+    if (name == "search") return make_unique<SearchPolicy>(rules, seconds, maxDepth);
+    throw runtime_error("Unknown policy " + name + " (use random, heuristic or search)");
+}
+
+// GameRecord Structure: How finished games are packed. A record is one byte
+// with the X and O policies (4 bits each), one byte with the number of
+// moves, then the moves' cells at moveBits bits each, low bits first, padded
+// to a whole byte: at most 7 bytes for a 3x3 game. A file starts with a
+// Header and the policy names, and holds count records.
+struct GameRecord {
+    struct Header {
+        char magic[8];
+        uint8_t rows, columns, k, policyCount;
+        uint32_t unused;
+        uint64_t count;
+    };
+    static constexpr char magicText[8] = "NCGAME1";
+    static const int maxPolicies = 16;
+    static const size_t nameSize = 16; // Bytes per policy name after the header
+
+    static int moveBits(const GameRules& rules) { return 64 - __builtin_clzll(uint64_t(rules.cellCount() - 1) | 1); }
+
+    // Function to append one game to out
+    static void append(vector<uint8_t>& out, int moveBits, int xPolicy, int oPolicy, const uint8_t* moves, int count) {
+        out.push_back(static_cast<uint8_t>(xPolicy << 4 | oPolicy));
+        out.push_back(static_cast<uint8_t>(count));
+        uint32_t pending = 0;
+        int bits = 0;
+        for (int i = 0; i < count; ++i) {
+            pending |= uint32_t(moves[i]) << bits;
+            for (bits += moveBits; bits >= 8; bits -= 8, pending >>= 8) out.push_back(static_cast<uint8_t>(pending));
+        }
+        if (bits > 0) out.push_back(static_cast<uint8_t>(pending));
+    }
+
+    // Function to size a record from its first two bytes
+    static size_t size(const uint8_t* record, int moveBits) { return 2 + (record[1] * moveBits + 7) / 8; }
+
+    // Function to unpack move i of a record
+    static int move(const uint8_t* record, int moveBits, int i) {
+        size_t bit = size_t(i) * moveBits;
+        uint32_t word = record[2 + bit / 8];
+        if (bit % 8 + moveBits > 8) word |= uint32_t(record[3 + bit / 8]) << 8;
+        return static_cast<int>(word >> (bit % 8) & ((1u << moveBits) - 1));
+    }
+};
+
+// TournamentStats Structure: Results by pairing, X's policy first
+struct TournamentStats {
+    vector<string> names;
+    vector<array<uint64_t, 3>> results; // X wins, draws, O wins for pairing x * names.size() + o
+    uint64_t games = 0;
+    uint64_t moves = 0;
+
+    // Function to find a policy's index by name, adding it if new
+    size_t index(const string& name) {
+        size_t i = find(names.begin(), names.end(), name) - names.begin();
+        if (i == names.size()) {
+            vector<array<uint64_t, 3>> grown((names.size() + 1) * (names.size() + 1), array<uint64_t, 3>{});
+            for (size_t x = 0; x < names.size(); ++x) {
+                for (size_t o = 0; o < names.size(); ++o) grown[x * (names.size() + 1) + o] = results[x * names.size() + o];
+            }
+            names.push_back(name);
+            results = move(grown);
+        }
+        return i;
+    }
+
+    void add(size_t x, size_t o, int winner, int length) { // winner: 0 X, 1 draw, 2 O
+        ++results[x * names.size() + o][winner];
+        ++games;
+        moves += length;
+    }
+};
+
 // Function declarations for modularity and readability
-void displayBoard(const vector<char>& board);       // Display the game board
-bool isValidMove(const vector<char>& board, int move); // Validate the player's move
-bool checkWin(const vector<char>& board, char player); // Check if a player has won
-bool isBoardFull(const vector<char>& board);        // Check if the board is full (draw condition)
-void playGame();                                    // Main game logic
-void displayInstructions();
-int main() {
-     displayInstructions();
+void displayBoard(const GameRules& rules, const Board& board);            // Display the game board
+bool isValidMove(const GameRules& rules, const Board& board, int move);   // Validate the player's move
+bool checkWin(const GameRules& rules, const Board& board, char player, int cell); // Check if a move won
+bool isBoardFull(const GameRules& rules, const Board& board);             // Check if the board is full (draw condition)
+void playGame(const GameRules& rules, ComputerPlayer* computer = nullptr, char computerPlays = 'O', double seconds = 1); // Main game logic
+void displayInstructions(const GameRules& rules);
+int solveBoard(const GameRules& rules, double seconds);                   // Time the computer on the empty board
+int solveInParallel(const GameRules& rules, unsigned threads, int splitPlies, size_t tableBits,
+                    const string& savePath); // Solve the empty board on 1..threads cores
+int runTournament(const GameRules& rules, const vector<string>& policies, size_t games, unsigned threads,
+                  uint64_t seed, double moveSeconds, int maxDepth, int openingPlies, const string& recordsPath); // Self-play
+int replayRecords(const vector<string>& paths);                           // Aggregate saved games
+int main(int argc, char* argv[]) {
+    // "[rows columns k]" plays on a larger board (up to 8x8), e.g. "5 5 4";
+    // "--computer X|O" lets the computer play that side, thinking for at most
+    // "--time seconds" a move, or playing from "--table file" where it can;
+    // "--solve" times the search on the empty board; "--solve-parallel
+    // [--threads N] [--split plies] [--table-bits N] [--save file]" solves
+    // it on 1 to N cores;
+    // "--tournament random,heuristic,search [--games N] [--threads N]
+    // [--depth N] [--time seconds] [--opening plies] [--seed N] [--records
+    // file]" plays the policies against each other; "--replay file" (given
+    // once per file) replays saved records
+    GameRules rules;
+    char computerPlays = 0;
+    double seconds = 1;
+    bool solve = false, solveParallel = false;
+    unsigned threads = max(thread::hardware_concurrency(), 1u);
+    int splitPlies = 3;
+    size_t tableBits = 0;
+    string savePath, tablePath, recordsPath;
+    vector<string> policies, replayPaths;
+    size_t games = 10000;
+    int maxDepth = 64, openingPlies = 0;
+    uint64_t seed = 42;
+    bool tournament = false;
+    try {
+        vector<int> sizes;
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            if (arg == "--computer" && i + 1 < argc) {
+                computerPlays = static_cast<char>(toupper(argv[++i][0]));
+                if (computerPlays != 'X' && computerPlays != 'O') throw invalid_argument("--computer takes X or O");
+            } else if (arg == "--time" && i + 1 < argc) {
+                seconds = stod(argv[++i]);
+                if (seconds <= 0) throw invalid_argument("--time must be positive");
+            } else if (arg == "--solve") {
+                solve = true;
+            } else if (arg == "--solve-parallel") {
+                solveParallel = true;
+            } else if (arg == "--threads" && i + 1 < argc) {
+                threads = static_cast<unsigned>(max(stoi(argv[++i]), 1));
+            } else if (arg == "--split" && i + 1 < argc) {
+                splitPlies = max(stoi(argv[++i]), 0);
+            } else if (arg == "--table-bits" && i + 1 < argc) {
+                int bits = stoi(argv[++i]);
+                if (bits < 1 || bits > 30) throw invalid_argument("--table-bits must be between 1 and 30");
+                tableBits = static_cast<size_t>(bits);
+            } else if (arg == "--save" && i + 1 < argc) {
+                savePath = argv[++i];
+            } else if (arg == "--table" && i + 1 < argc) {
+                tablePath = argv[++i];
+            } else if (arg == "--tournament" && i + 1 < argc) {
+                tournament = true;
+                istringstream list(argv[++i]);
+                for (string name; getline(list, name, ',');) policies.push_back(name);
+            } else if (arg == "--games" && i + 1 < argc) {
+                games = stoul(argv[++i]);
+            } else if (arg == "--depth" && i + 1 < argc) {
+                maxDepth = max(stoi(argv[++i]), 1);
+            } else if (arg == "--opening" && i + 1 < argc) {
+                openingPlies = max(stoi(argv[++i]), 0);
+            } else if (arg == "--seed" && i + 1 < argc) {
+                seed = stoull(argv[++i]);
+            } else if (arg == "--records" && i + 1 < argc) {
+                recordsPath = argv[++i];
+            } else if (arg == "--replay" && i + 1 < argc) {
+                replayPaths.push_back(argv[++i]);
+            } else {
+                sizes.push_back(stoi(arg));
+            }
+        }
+        if (sizes.size() == 3) rules = GameRules(sizes[0], sizes[1], sizes[2]);
+        else if (!sizes.empty()) throw invalid_argument("give the board as rows columns k");
+    } catch (const exception& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    if (solve) return solveBoard(rules, seconds);
+    if (solveParallel) return solveInParallel(rules, threads, splitPlies, tableBits, savePath);
+    if (tournament || !replayPaths.empty()) {
+        try {
+            if (tournament) return runTournament(rules, policies, games, threads, seed, seconds, maxDepth, openingPlies, recordsPath);
+            return replayRecords(replayPaths);
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+    ComputerPlayer computer(rules); // Keeps what it learns between games
+    unique_ptr<SolvedTable> table;
+    if (!tablePath.empty()) {
+        try {
+            table = make_unique<SolvedTable>(tablePath, rules);
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        computer.useTable(table.get());
+    }
+     displayInstructions(rules);
     char playAgain = 'y'; // Option for replaying the game
     do {
-        playGame(); // Start the game
+        playGame(rules, computerPlays ? &computer : nullptr, computerPlays, seconds); // Start the game
         cout << "Do you want to play again? (y/n): ";
-        cin >> playAgain; // Ask the player if they want to play again
+        if (!(cin >> playAgain)) break; // Ask the player if they want to play again (stop if input ended)
     } while (playAgain == 'y' || playAgain == 'Y'); // Continue if the player says 'y'
     return 0;
 }
 
 // Function to display the Tic-Tac-Toe board
-void displayBoard(const vector<char>& board) {
-    // Display the 3x3 board layout using the values in the board vector
+void displayBoard(const GameRules& rules, const Board& board) {
+    // Empty cells show their move number; numbers past 9 need wider cells
+    int width = rules.cellCount() > 9 ? 2 : 1;
+    string separator;
+    for (int c = 0; c < rules.columns(); ++c) separator += string(width + 2, '-') + (c + 1 < rules.columns() ? "|" : "");
     cout << "\n";
-    for (int i = 0; i < 9; i += 3) { // Iterate through rows (3 cells at a time)
-        cout << " " << board[i] << " | " << board[i + 1] << " | " << board[i + 2] << "\n"; // Display a row
-        if (i < 6) cout << "---|---|---\n"; // Add a separator after each row except the last
+    for (int r = 0; r < rules.rows(); ++r) { // Iterate through rows
+        for (int c = 0; c < rules.columns(); ++c) {
+            int cell = r * rules.columns() + c;
+            string mark = board.marks[0] >> cell & 1 ? "X" : board.marks[1] >> cell & 1 ? "O" : to_string(cell + 1);
+            cout << " " << string(width - mark.size(), ' ') << mark << " " << (c + 1 < rules.columns() ? "|" : "");
+        }
+        cout << "\n";
+        if (r + 1 < rules.rows()) cout << separator << "\n"; // Add a separator after each row except the last
     }
     cout << "\n";
 }
 
 // Function to check if a move is valid
-bool isValidMove(const vector<char>& board, int move) {
-    // A valid move is within 1-9 and targets an unoccupied cell
-    return move >= 1 && move <= 9 && board[move - 1] == '0' + move;
+bool isValidMove(const GameRules& rules, const Board& board, int move) {
+    // A valid move is a cell number on the board whose cell is unoccupied
+    return move >= 1 && move <= rules.cellCount() && board.isEmpty(move - 1);
 }
 
-// Function to check if a player has won
-bool checkWin(const vector<char>& board, char player) {
-    // Define the 8 possible winning patterns: rows, columns, diagonals
-    int winPatterns[8][3] = {
-        {0, 1, 2}, {3, 4, 5}, {6, 7, 8}, // Rows
-        {0, 3, 6}, {1, 4, 7}, {2, 5, 8}, // Columns
-        {0, 4, 8}, {2, 4, 6}             // Diagonals
-    };
-
-    // Check if any winning pattern matches the current player's marks
-    for (auto& pattern : winPatterns) {
-        if (board[pattern[0]] == player &&
-            board[pattern[1]] == player &&
-            board[pattern[2]] == player) {
-            return true; // Player wins if all 3 cells in a pattern match their mark
-        }
-    }
-    return false; // No winning pattern found
+// Function to check if a player's move at cell has won
+bool checkWin(const GameRules& rules, const Board& board, char player, int cell) {
+    // Only the precomputed lines through the new mark can have been completed
+    return rules.winsAt(board.marks[player == 'X' ? 0 : 1], cell);
 }
 
 // Function to check if the board is full
-bool isBoardFull(const vector<char>& board) {
-    // If any cell is still a number (not 'X' or 'O'), the board is not full
-    for (const char& cell : board) {
-        if (cell != 'X' && cell != 'O') {
-            return false;
-        }
-    }
-    return true; // All cells are occupied
+bool isBoardFull(const GameRules& rules, const Board& board) {
+    return rules.isFull(board.occupied()); // One OR and a compare
 }
 
 // Main game logic
-void playGame() {
-    // Initialize the game board with numbers 1-9
-    vector<char> board(9);
-    for (int i = 0; i < 9; ++i) board[i] = '1' + i;
+void playGame(const GameRules& rules, ComputerPlayer* computer, char computerPlays, double seconds) {
+    Board board; // Every cell starts empty
 
     char currentPlayer = 'X'; // 'X' always starts the game
     int move; // Variable to hold the player's move
 
     while (true) {
-        displayBoard(board); // Show the current state of the board
+        displayBoard(rules, board); // Show the current state of the board
 
-        // Prompt the current player for their move
-        cout << "Player " << currentPlayer << ", enter your move (1-9): ";
-        if (!(cin >> move)) { // Handle invalid input (e.g., non-integer values)
-            cout << "Invalid input. Please enter a number between 1 and 9.\n";
-            cin.clear();             // Clear the error flag
-            cin.ignore(1000, '\n');  // Discard invalid input
-            continue; // Skip to the next iteration to prompt again
-        }
+        if (computer && currentPlayer == computerPlays) {
+            ComputerPlayer::SearchInfo info = computer->chooseMove(board, seconds);
+            move = info.move + 1;
+            cout << "Computer (" << currentPlayer << ") plays " << move;
+            if (info.solved) {
+                cout << (info.score > 0 ? " (it will win)" : info.score < 0 ? " (it should lose)" : " (a draw with best play)");
+            }
+            cout << "\n";
+        } else {
+            // Prompt the current player for their move
+            cout << "Player " << currentPlayer << ", enter your move (1-" << rules.cellCount() << "): ";
+            if (!(cin >> move)) { // Handle invalid input (e.g., non-integer values)
+                if (cin.eof()) return; // No more input
+                cout << "Invalid input. Please enter a number between 1 and " << rules.cellCount() << ".\n";
+                cin.clear();             // Clear the error flag
+                cin.ignore(1000, '\n');  // Discard invalid input
+                continue; // Skip to the next iteration to prompt again
+            }
 
-        // Validate the move
-        if (!isValidMove(board, move)) {
-            cout << "Invalid move. Please try again.\n";
-            continue; // Skip to the next iteration if the move is invalid
+            // Validate the move
+            if (!isValidMove(rules, board, move)) {
+                cout << "Invalid move. Please try again.\n";
+                continue; // Skip to the next iteration if the move is invalid
+            }
         }
 
         // Make the move
-        board[move - 1] = currentPlayer;
+        board.play(move - 1);
 
         // Check for a win condition
-        if (checkWin(board, currentPlayer)) {
-            displayBoard(board); // Display the final board state
+        if (checkWin(rules, board, currentPlayer, move - 1)) {
+            displayBoard(rules, board); // Display the final board state
             cout << "Player " << currentPlayer << " wins!\n";
             break; // Exit the game loop
         }
 
         // Check for a draw (board is full, no winner)
-        if (isBoardFull(board)) {
-            displayBoard(board); // Display the final board state
+        if (isBoardFull(rules, board)) {
+            displayBoard(rules, board); // Display the final board state
             cout << "It's a draw!\n";
             break; // Exit the game loop
         }
@@ -116,13 +1234,293 @@ void playGame() {
         currentPlayer = (currentPlayer == 'X') ? 'O' : 'X';
     }
 }
-void displayInstructions() {
+void displayInstructions(const GameRules& rules) {
     cout << "Welcome to Noughts and Crosses (Tic-Tac-Toe)!" << endl;
     cout << "Instructions:" << endl;
-    cout << "1. The game is played on a 3x3 grid." << endl;
+    cout << "1. The game is played on a " << rules.rows() << "x" << rules.columns() << " grid." << endl;
     cout << "2. Player 1 is 'X' and Player 2 is 'O'." << endl;
     cout << "3. Take turns to place your mark on an empty cell." << endl;
-    cout << "4. The first player to get three in a row wins!" << endl;
+    cout << "4. The first player to get " << rules.k() << " in a row wins!" << endl;
     cout << "5. If all cells are filled without a winner, it's a draw." << endl;
     cout << "Let's begin!\n" << endl;
 }
+
+// Function to time the computer on the empty board: once with an empty
+// transposition table, then again now that the table holds the answer
+int solveBoard(const GameRules& rules, double seconds) {
+    ComputerPlayer computer(rules);
+    Board empty;
+    const char* runs[] = {"cold", "warm"};
+    for (const char* run : runs) {
+        ComputerPlayer::SearchInfo info = computer.chooseMove(empty, seconds);
+        cout << rules.rows() << "x" << rules.columns() << " k=" << rules.k() << " (" << run << "): ";
+        if (info.solved) cout << (info.score > 0 ? "X wins" : info.score < 0 ? "O wins" : "draw") << " with best play";
+        else cout << "unsolved after depth " << info.depth << ", score " << info.score;
+        cout << ", best move " << info.move + 1 << ", " << info.nodes << " nodes in "
+             << info.seconds * 1e6 << " us\n";
+    }
+    return 0;
+}
+
+// Function to solve the empty board with 1, 2, 4, ... up to threads workers,
+// each time from an empty table of 2^tableBits slots (0 sizes it for the
+// board), and save what the last solve learned
+int solveInParallel(const GameRules& rules, unsigned threads, int splitPlies, size_t tableBits, const string& savePath) {
+    ParallelSolver solver(rules, tableBits);
+    cout << "Table: " << solver.tableSlots() << " slots (" << solver.tableBytes() << " bytes)\n";
+    vector<unsigned> counts;
+    for (unsigned t = 1; t < threads; t *= 2) counts.push_back(t);
+    counts.push_back(threads);
+    double oneThread = 0;
+    for (unsigned t : counts) {
+        solver.clear();
+        ParallelSolver::Result result = solver.solve(Board(), t, splitPlies);
+        if (t == 1) oneThread = result.seconds;
+        cout << rules.rows() << "x" << rules.columns() << " k=" << rules.k() << ", " << t << " thread(s): "
+             << (result.outcome > 0 ? "X wins" : result.outcome < 0 ? "O wins" : "draw") << " with best play, "
+             << result.nodes << " nodes in " << result.seconds << " s, "
+             << result.nodes / result.seconds / 1e6 << " M nodes/s, speedup " << oneThread / result.seconds << "\n";
+    }
+    if (!savePath.empty()) {
+        try {
+            size_t saved = solver.save(savePath);
+            cout << "Saved " << saved << " positions (" << saved * sizeof(uint64_t) << " bytes) to " << savePath << "\n";
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to print a tournament's results: each pairing as X wins / draws /
+// O wins in percent, then every policy's record over both colours
+void printStandings(const TournamentStats& stats, double seconds) {
+    size_t n = stats.names.size();
+    cout << fixed;
+    cout.precision(1);
+    cout << "X wins / draws / O wins (%), X down the side, O across\n" << left;
+    cout.width(12);
+    cout << "";
+    for (const string& name : stats.names) {
+        cout.width(20);
+        cout << name;
+    }
+    cout << "\n";
+    for (size_t x = 0; x < n; ++x) {
+        cout.width(12);
+        cout << stats.names[x];
+        for (size_t o = 0; o < n; ++o) {
+            const array<uint64_t, 3>& r = stats.results[x * n + o];
+            double games = max<double>(r[0] + r[1] + r[2], 1) / 100;
+            ostringstream cell;
+            cell.setf(ios::fixed);
+            cell.precision(1);
+            cell << r[0] / games << "/" << r[1] / games << "/" << r[2] / games;
+            cout.width(20);
+            cout << cell.str();
+        }
+        cout << "\n";
+    }
+    cout << "Policy      Games       Wins        Draws       Losses      Score\n";
+    for (size_t p = 0; p < n; ++p) {
+        uint64_t wins = 0, draws = 0, losses = 0;
+        for (size_t other = 0; other < n; ++other) {
+            const array<uint64_t, 3>& asX = stats.results[p * n + other];
+            const array<uint64_t, 3>& asO = stats.results[other * n + p];
+            wins += asX[0] + asO[2];
+            draws += asX[1] + asO[1];
+            losses += asX[2] + asO[0];
+        }
+        uint64_t games = wins + draws + losses;
+        cout.width(12);
+        cout << stats.names[p];
+        for (uint64_t value : { games, wins, draws, losses }) {
+            cout.width(12);
+            cout << value;
+        }
+        cout << 100.0 * (wins + draws / 2.0) / max<uint64_t>(games, 1) << "%\n";
+    }
+    cout << right;
+    cout << "Games: " << stats.games << ", average length " << double(stats.moves) / max<uint64_t>(stats.games, 1)
+         << " moves, " << static_cast<long>(stats.games / max(seconds, 1e-9)) << " games per second\n";
+}
+
+// Function to play games headless, split across threads. Every ordered
+// pairing of the policies (self-play included) plays games games, each
+// opening with openingPlies random moves. Each thread keeps its own players
+// and packed records; the records are written to recordsPath if given.
+// Results depend only on the seed and thread count (and, for search, on
+// the time budget not running out).
+int runTournament(const GameRules& rules, const vector<string>& policies, size_t games, unsigned threads,
+                  uint64_t seed, double moveSeconds, int maxDepth, int openingPlies, const string& recordsPath) {
+    if (policies.empty() || policies.size() > GameRecord::maxPolicies) throw runtime_error("Give 1 to 16 policies");
+    for (size_t i = 0; i < policies.size(); ++i) {
+        if (find(policies.begin(), policies.begin() + i, policies[i]) != policies.begin() + i) {
+            throw runtime_error("Policy " + policies[i] + " is listed twice");
+        }
+        makePolicy(policies[i], rules, seed, moveSeconds, maxDepth); // Fail on an unknown name before starting threads
+    }
+    size_t n = policies.size(), total = games * n * n;
+    int moveBits = GameRecord::moveBits(rules);
+
+    vector<TournamentStats> results(threads);
+    vector<vector<uint8_t>> records(threads);
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            FastRandom random(seed * 0x9e3779b97f4a7c15ull + t);
+            vector<unique_ptr<Policy>> players;
+            TournamentStats& stats = results[t];
+            for (const string& name : policies) {
+                players.push_back(makePolicy(name, rules, random.next(), moveSeconds, maxDepth));
+                stats.index(name);
+            }
+            if (!recordsPath.empty()) records[t].reserve(total / threads * (2 + (rules.cellCount() * moveBits + 7) / 8));
+            for (size_t g = t; g < total; g += threads) {
+                size_t x = g / n % n, o = g % n;
+                Board board;
+                uint8_t moves[64];
+                int count = 0, winner = 1; // Draw unless a line is completed
+                while (true) {
+                    int mover = board.toMove();
+                    int cell = count < openingPlies ? random.pick(~board.occupied() & rules.fullMask())
+                                                    : players[mover == 0 ? x : o]->chooseMove(board);
+                    board.play(cell);
+                    moves[count++] = static_cast<uint8_t>(cell);
+                    if (rules.winsAt(board.marks[mover], cell)) {
+                        winner = mover == 0 ? 0 : 2;
+                        break;
+                    }
+                    if (rules.isFull(board.occupied())) break;
+                }
+                stats.add(x, o, winner, count);
+                if (!recordsPath.empty()) GameRecord::append(records[t], moveBits, static_cast<int>(x), static_cast<int>(o), moves, count);
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    TournamentStats combined;
+    for (const string& name : policies) combined.index(name);
+    for (const TournamentStats& stats : results) {
+        for (size_t i = 0; i < combined.results.size(); ++i) {
+            for (int r = 0; r < 3; ++r) combined.results[i][r] += stats.results[i][r];
+        }
+        combined.games += stats.games;
+        combined.moves += stats.moves;
+    }
+    cout << rules.rows() << "x" << rules.columns() << " k=" << rules.k() << ", " << threads << " thread(s)\n";
+    printStandings(combined, seconds);
+
+    if (!recordsPath.empty()) {
+        GameRecord::Header header = {};
+        memcpy(header.magic, GameRecord::magicText, sizeof(header.magic));
+        header.rows = static_cast<uint8_t>(rules.rows());
+        header.columns = static_cast<uint8_t>(rules.columns());
+        header.k = static_cast<uint8_t>(rules.k());
+        header.policyCount = static_cast<uint8_t>(n);
+        header.count = total;
+        ofstream file(recordsPath, ios::binary | ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        size_t bytes = 0;
+        for (const string& name : policies) {
+            char padded[GameRecord::nameSize] = {};
+            memcpy(padded, name.data(), min(name.size(), sizeof(padded) - 1));
+            file.write(padded, sizeof(padded));
+        }
+        for (const vector<uint8_t>& block : records) {
+            file.write(reinterpret_cast<const char*>(block.data()), static_cast<streamsize>(block.size()));
+            bytes += block.size();
+        }
+        if (!file.flush()) throw runtime_error("Cannot write records " + recordsPath);
+        cout << "Wrote " << total << " games in " << bytes << " bytes (" << double(bytes) / max<size_t>(total, 1)
+             << " per game) to " << recordsPath << "\n";
+    }
+    return 0;
+}
+
+// Function to replay the games in record files, checking every move, and
+// print the combined results. The files are mapped, not read, and must all
+// be for the same board.
+int replayRecords(const vector<string>& paths) {
+    TournamentStats stats;
+    auto start = chrono::steady_clock::now();
+    int rows = 0, columns = 0, k = 0;
+    for (const string& path : paths) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw runtime_error("Cannot open records " + path + ": " + strerror(errno));
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw runtime_error("Cannot read records " + path + ": " + strerror(errno));
+        }
+        size_t size = static_cast<size_t>(info.st_size);
+        if (size < sizeof(GameRecord::Header)) {
+            close(fd);
+            throw runtime_error(path + " is not a game record file");
+        }
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) throw runtime_error("Cannot map records " + path + ": " + strerror(errno));
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        const uint8_t* data = static_cast<const uint8_t*>(mapped);
+        const uint8_t* end = data + size;
+
+        try {
+            GameRecord::Header header;
+            memcpy(&header, data, sizeof(header));
+            size_t namesEnd = sizeof(header) + header.policyCount * GameRecord::nameSize;
+            if (memcmp(header.magic, GameRecord::magicText, sizeof(header.magic)) != 0 || size < namesEnd ||
+                header.policyCount > GameRecord::maxPolicies) {
+                throw runtime_error(path + " is not a game record file");
+            }
+            if (rows == 0) {
+                rows = header.rows;
+                columns = header.columns;
+                k = header.k;
+            } else if (header.rows != rows || header.columns != columns || header.k != k) {
+                throw runtime_error(path + " was played on a different board");
+            }
+            GameRules rules(header.rows, header.columns, header.k);
+            int moveBits = GameRecord::moveBits(rules);
+            vector<size_t> index;
+            for (int p = 0; p < header.policyCount; ++p) {
+                const char* name = reinterpret_cast<const char*>(data + sizeof(header) + p * GameRecord::nameSize);
+                index.push_back(stats.index(string(name, strnlen(name, GameRecord::nameSize))));
+            }
+
+            const uint8_t* record = data + namesEnd;
+            for (uint64_t r = 0; r < header.count; ++r) {
+                if (end - record < 2 || static_cast<size_t>(end - record) < GameRecord::size(record, moveBits)) {
+                    throw runtime_error(path + " is truncated");
+                }
+                int x = record[0] >> 4, o = record[0] & 15, count = record[1];
+                if (x >= header.policyCount || o >= header.policyCount) throw runtime_error(path + " has a bad record");
+                Board board;
+                int winner = 1;
+                for (int i = 0; i < count; ++i) {
+                    int cell = GameRecord::move(record, moveBits, i);
+                    if (winner != 1 || cell >= rules.cellCount() || !board.isEmpty(cell)) {
+                        throw runtime_error(path + " has an illegal move in game " + to_string(r + 1));
+                    }
+                    int mover = board.toMove();
+                    board.play(cell);
+                    if (rules.winsAt(board.marks[mover], cell)) winner = mover == 0 ? 0 : 2;
+                }
+                stats.add(index[x], index[o], winner, count);
+                record += GameRecord::size(record, moveBits);
+            }
+        } catch (...) {
+            munmap(mapped, size);
+            throw;
+        }
+        munmap(mapped, size);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Replayed " << paths.size() << " file(s) of " << rows << "x" << columns << " k=" << k << " games\n";
+    printStandings(stats, seconds);
+    return 0;
+}
@@ -2,11 +2,277 @@
 #include <fstream> // is essential for file operations (reading and writing) in C++.
 #include <string>
 #include <filesystem> // For filesystem operations such as checking file existence and renaming
+#include <vector> // For the names read from a directory
+#include <deque> // For the queue of directories waiting for a worker
+#include <thread> // For the batch worker threads
+#include <mutex> // For the directory queue lock
+#include <condition_variable> // For workers waiting on the directory queue
+#include <atomic> // For the batch summary counters
+#include <chrono> // For timing batch runs
+#include <map> // For the manifest, sorted by original path
+#ifndef _WIN32
+#include <cstdio> // For renameat2 (Linux) and renameatx_np (macOS)
+#include <cstring> // For strerror when reporting failed system calls
+#include <cerrno> // For errno set by system calls
+#include <fcntl.h> // For openat and its flags
+#include <unistd.h> // For close
+#include <dirent.h> // For fdopendir/readdir
+#include <sys/stat.h> // For fstatat when readdir does not report the entry type
+#include <memory> // For the per-thread io_uring instance
+#include <cstdint> // For the fixed-width fields of manifest records
+#include <cstdlib> // For mkstemp when writing a transformed copy
+#include <sys/file.h> // For flock on the manifest
+#include <sys/mman.h> // For mapping the io_uring queues and files being obfuscated
+#endif
+#ifdef __linux__
+#include <sys/syscall.h> // For the io_uring system call numbers
+#include <linux/io_uring.h> // For the io_uring structures and opcodes
+#endif
 using namespace std;
 namespace fs = std::filesystem; // Alias for the filesystem namespace to simplify code
 
-// Function to hide a file
-void hideFile(const string& filePath) {
+class HiddenManifest; // Record of hidden files (Linux/macOS only, see below)
+
+#ifndef _WIN32
+// HiddenManifest Class: Crash-safe record of the files hidefiles has hidden,
+// mapping each original (absolute) path to its hidden path, so they can be
+// listed or unhidden without walking the filesystem. Changes are appended
+// to a log of checksummed records and flushed with fdatasync on commit; a
+// torn record at the end of the log (from a crash) is dropped when it is
+// loaded. Once most records are stale the log is rewritten compactly.
+// The file stays locked while open, so two runs never interleave records.
+class HiddenManifest {
+private:
+    // Header of each log record, followed by the original and hidden paths
+    struct RecordHeader {
+        uint32_t checksum;       // FNV-1a of the rest of the header and the paths
+        uint32_t kind;           // recordHidden or recordUnhidden
+        uint32_t originalLength; // Bytes of the original path
+        uint32_t hiddenLength;   // Bytes of the hidden path (0 when unhidden)
+    };
+    static const uint32_t recordHidden = 1;
+    static const uint32_t recordUnhidden = 2;
+    static const size_t compactAfter = 1024; // Never compact a log shorter than this
+
+    string path;                  // Location of the manifest
+    int fd = -1;                  // Open, locked manifest
+    map<string, string> entries;  // Original path -> hidden path, sorted for prefix queries
+    size_t logRecords = 0;        // Records in the file, live or not
+    string pending;               // Encoded records not yet written
+    mutable mutex manifestMutex;  // Guards everything above; batch workers record concurrently
+
+public:
+    explicit HiddenManifest(const string& manifestPath) : path(manifestPath) {
+        openLocked();
+        load();
+    }
+
+    HiddenManifest(const HiddenManifest&) = delete;
+    HiddenManifest& operator=(const HiddenManifest&) = delete;
+
+    // Destructor writes whatever is still pending
+    ~HiddenManifest() {
+        try {
+            commit();
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+        }
+        if (fd >= 0) close(fd);
+    }
+
+    // Function to find the manifest: $HIDEFILES_MANIFEST, else ~/.hidefiles-manifest
+    static string defaultPath() {
+        if (const char* configured = getenv("HIDEFILES_MANIFEST")) return configured;
+        if (const char* home = getenv("HOME")) return string(home) + "/.hidefiles-manifest";
+        return ".hidefiles-manifest";
+    }
+
+    // Function to note that a file was hidden
+    void recordHide(const string& original, const string& hidden) {
+        lock_guard<mutex> lock(manifestMutex);
+        entries[original] = hidden;
+        encode(recordHidden, original, hidden);
+    }
+
+    // Function to note that a file was unhidden (nothing is written for files the manifest never had)
+    void recordUnhide(const string& original) {
+        lock_guard<mutex> lock(manifestMutex);
+        if (entries.erase(original) == 0) return;
+        encode(recordUnhidden, original, "");
+    }
+
+    // Function to list the hidden files whose original path is prefix or lies below it
+    vector<pair<string, string>> listUnder(const string& prefix) const {
+        lock_guard<mutex> lock(manifestMutex);
+        string directory = prefix.empty() || prefix.back() == '/' ? prefix : prefix + "/";
+        vector<pair<string, string>> found;
+        auto exact = entries.find(prefix);
+        if (exact != entries.end() && !prefix.empty()) found.push_back(*exact);
+        for (auto it = entries.lower_bound(directory); it != entries.end(); ++it) {
+            if (it->first.compare(0, directory.size(), directory) != 0) break;
+            found.push_back(*it);
+        }
+        return found;
+    }
+
+    size_t size() const {
+        lock_guard<mutex> lock(manifestMutex);
+        return entries.size();
+    }
+
+    // Function to write pending records and flush them to disk, compacting
+    // the log first if most of its records no longer matter
+    void commit() {
+        lock_guard<mutex> lock(manifestMutex);
+        if (logRecords > compactAfter && logRecords > 2 * entries.size()) {
+            compact();
+            return;
+        }
+        flushPending();
+        if (fdatasync(fd) != 0) {
+            throw runtime_error("Failed to sync manifest " + path + ": " + strerror(errno));
+        }
+    }
+
+private:
+    // Function to open the manifest and take its lock. If another run
+    // compacted it while this one waited, the lock is on a replaced file,
+    // so the current one is opened again.
+    void openLocked() {
+        while (true) {
+            fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+            if (fd < 0) {
+                throw runtime_error("Cannot open manifest " + path + ": " + strerror(errno));
+            }
+            if (flock(fd, LOCK_EX) != 0) {
+                throw runtime_error("Cannot lock manifest " + path + ": " + strerror(errno));
+            }
+            struct stat opened, current;
+            if (fstat(fd, &opened) == 0 && stat(path.c_str(), &current) == 0 && opened.st_ino == current.st_ino &&
+                opened.st_dev == current.st_dev) {
+                return;
+            }
+            close(fd);
+        }
+    }
+
+    // Function to compute a record checksum
+    static uint32_t checksum(const char* data, size_t size, uint32_t hash = 2166136261u) {
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+        }
+        return hash;
+    }
+
+    // Function to append one encoded record to a buffer
+    static void appendRecord(string& out, uint32_t kind, const string& original, const string& hidden) {
+        RecordHeader header{ 0, kind, static_cast<uint32_t>(original.size()), static_cast<uint32_t>(hidden.size()) };
+        uint32_t hash = checksum(reinterpret_cast<const char*>(&header) + 4, sizeof(header) - 4);
+        hash = checksum(original.data(), original.size(), hash);
+        header.checksum = checksum(hidden.data(), hidden.size(), hash);
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        out += original;
+        out += hidden;
+    }
+
+    // Function to add one encoded record to the pending buffer
+    void encode(uint32_t kind, const string& original, const string& hidden) {
+        appendRecord(pending, kind, original, hidden);
+        ++logRecords;
+        if (pending.size() >= (1 << 20)) flushPending(); // Large batches write as they go
+    }
+
+    // Function to write the pending records to the file (without syncing)
+    void flushPending() {
+        writeAll(fd, pending.data(), pending.size());
+        pending.clear();
+    }
+
+    static void writeAll(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw runtime_error("Failed to write manifest: " + string(strerror(errno)));
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+    }
+
+    // Function to rebuild the entries from the log, cutting off a torn tail
+    void load() {
+        string log;
+        char buffer[1 << 16];
+        ssize_t got;
+        while ((got = pread(fd, buffer, sizeof(buffer), static_cast<off_t>(log.size()))) != 0) {
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                throw runtime_error("Failed to read manifest " + path + ": " + strerror(errno));
+            }
+            log.append(buffer, static_cast<size_t>(got));
+        }
+
+        size_t offset = 0;
+        while (log.size() - offset >= sizeof(RecordHeader)) {
+            RecordHeader header;
+            memcpy(&header, log.data() + offset, sizeof(header));
+            size_t payload = static_cast<size_t>(header.originalLength) + header.hiddenLength;
+            if (payload > log.size() - offset - sizeof(header)) break;
+            const char* paths = log.data() + offset + sizeof(header);
+            uint32_t hash = checksum(log.data() + offset + 4, sizeof(header) - 4);
+            if (checksum(paths, payload, hash) != header.checksum) break;
+            string original(paths, header.originalLength);
+            if (header.kind == recordHidden) {
+                entries[original] = string(paths + header.originalLength, header.hiddenLength);
+            } else {
+                entries.erase(original);
+            }
+            ++logRecords;
+            offset += sizeof(header) + payload;
+        }
+        if (offset != log.size()) {
+            // The last write was cut short; drop it so new records follow valid ones
+            if (ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+                throw runtime_error("Failed to repair manifest " + path + ": " + strerror(errno));
+            }
+        }
+    }
+
+    // Function to replace the log with one record per hidden file. The new
+    // log is synced before it replaces the old, so a crash leaves one or the other.
+    // It is built in its own buffer: encode would flush large batches to the old log.
+    void compact() {
+        string compacted;
+        for (const auto& [original, hidden] : entries) appendRecord(compacted, recordHidden, original, hidden);
+
+        string tmpPath = path + ".tmp";
+        int tmpFd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0600);
+        if (tmpFd < 0) {
+            throw runtime_error("Cannot create " + tmpPath + ": " + strerror(errno));
+        }
+        try {
+            if (flock(tmpFd, LOCK_EX) != 0) throw runtime_error("Cannot lock " + tmpPath + ": " + strerror(errno));
+            writeAll(tmpFd, compacted.data(), compacted.size());
+            if (fsync(tmpFd) != 0) throw runtime_error("Failed to sync " + tmpPath + ": " + strerror(errno));
+            if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+                throw runtime_error("Failed to replace manifest " + path + ": " + strerror(errno));
+            }
+        } catch (...) {
+            close(tmpFd);
+            unlink(tmpPath.c_str());
+            throw;
+        }
+        pending.clear(); // Everything pending is reflected in the entries just written
+        logRecords = entries.size();
+        close(fd); // Runs waiting on the old file will notice it was replaced
+        fd = tmpFd;
+    }
+};
+#endif
+
+// Function to hide a file, noting it in the manifest if one is given
+void hideFile(const string& filePath, HiddenManifest* manifest = nullptr) {
     // Check if the file exists
     if (!fs::exists(filePath)) { // fs::exists checks if the file path points to an existing file
         cerr << "Error: File does not exist.\n";
@@ -21,16 +287,32 @@ void hideFile(const string& filePath) {
     } else {
         cerr << "Error hiding the file.\n";
     }
+    (void)manifest;
 #else // Linux/macOS-specific code
     // On Linux/macOS, a file is considered hidden if its name starts with a dot (.)
-    string newFileName = "." + filePath; // Prepend a dot to the file name to hide it
-    fs::rename(filePath, newFileName);  // Rename the file using the filesystem library
-    cout << "File hidden successfully as " << newFileName << ".\n";
+    fs::path original(filePath);
+    string fileName = original.filename().string();
+    if (fileName.empty() || fileName[0] == '.') {
+        cerr << "Error: File is already hidden.\n";
+        return;
+    }
+    fs::path newFileName = original.parent_path() / ("." + fileName); // Prepend a dot to the file name (not the whole path)
+    if (fs::exists(newFileName)) {
+        cerr << "Error: " << newFileName.string() << " already exists.\n";
+        return;
+    }
+    fs::rename(original, newFileName);  // Rename the file using the filesystem library
+    if (manifest != nullptr) {
+        manifest->recordHide(fs::absolute(original).lexically_normal().string(),
+                             fs::absolute(newFileName).lexically_normal().string());
+        manifest->commit();
+    }
+    cout << "File hidden successfully as " << newFileName.string() << ".\n";
 #endif
 }
 
-// Function to unhide a file
-void unhideFile(const string& filePath) {
+// Function to unhide a file, removing it from the manifest if one is given
+void unhideFile(const string& filePath, HiddenManifest* manifest = nullptr) {
     // Check if the file exists
     if (!fs::exists(filePath)) { // Ensure the file exists before attempting to unhide it
         cerr << "Error: File does not exist.\n";
@@ -45,25 +327,1133 @@ void unhideFile(const string& filePath) {
     } else {
         cerr << "Error unhiding the file.\n";
     }
+    (void)manifest;
 #else // Linux/macOS-specific code
     // On Linux/macOS, remove the dot prefix to unhide the file
-    if (filePath[0] == '.') { // Check if the file name starts with a dot
-        string newFileName = filePath.substr(1); // Remove the first character (dot) from the file name
-        fs::rename(filePath, newFileName); // Rename the file using the filesystem library
-        cout << "File unhidden successfully as " << newFileName << ".\n";
+    fs::path hidden(filePath);
+    string fileName = hidden.filename().string();
+    if (fileName.size() > 1 && fileName[0] == '.') { // Check if the file name (not the whole path) starts with a dot
+        fs::path newFileName = hidden.parent_path() / fileName.substr(1); // Remove the dot from the file name
+        if (fs::exists(newFileName)) {
+            cerr << "Error: " << newFileName.string() << " already exists.\n";
+            return;
+        }
+        fs::rename(hidden, newFileName); // Rename the file using the filesystem library
+        if (manifest != nullptr) {
+            manifest->recordUnhide(fs::absolute(newFileName).lexically_normal().string());
+            manifest->commit();
+        }
+        cout << "File unhidden successfully as " << newFileName.string() << ".\n";
     } else {
         cerr << "Error: File is not hidden.\n"; // File does not appear to be hidden (no dot prefix)
     }
 #endif
 }
 
-int main() {
+// Enum for the direction of a batch rename
+enum class Mode { hide, unhide };
+
+// Structure for the counters printed after a batch run
+struct BatchSummary {
+    atomic<size_t> directories{0}; // Directories read
+    atomic<size_t> renamed{0};     // Entries hidden or unhidden
+    atomic<size_t> unchanged{0};   // Entries that were already hidden (or visible)
+    atomic<size_t> conflicts{0};   // Entries skipped because the new name was taken
+    atomic<size_t> errors{0};      // Entries that could not be read or renamed
+};
+
+// Function to work out the name an entry should have after hiding or
+// unhiding it. Returns false if the entry is already in that state.
+bool targetName(const string& name, Mode mode, string& newName) {
+    bool hidden = name[0] == '.';
+    if (mode == Mode::hide) {
+        if (hidden) return false;
+        newName = "." + name; // Prepend a dot to the file name to hide it
+    } else {
+        if (!hidden || name.size() < 2) return false;
+        newName = name.substr(1); // Remove the dot to unhide it
+    }
+    return true;
+}
+
+#ifndef _WIN32 // Batch mode works on directory file descriptors (Linux/macOS only)
+// Function to report a failed system call on one entry and count it
+void reportError(BatchSummary& summary, const string& what, const string& name) {
+    string message = "Error: " + what + " " + name + ": " + strerror(errno) + "\n";
+    cerr << message; // One write per message, so threads do not interleave
+    summary.errors.fetch_add(1);
+}
+
+// Enum for how a batch performs its renames
+enum class Engine { sync, uring };
+
+// Structure for the settings of a batch run
+struct BatchOptions {
+    Mode mode = Mode::hide;        // Hide or unhide
+    bool recursive = false;        // Whether to descend into subdirectories
+    Engine engine = Engine::sync;  // How renames are performed
+    unsigned queueDepth = 64;      // Renames in flight per thread with io_uring
+    unsigned threadCount = max(thread::hardware_concurrency(), 1u); // Worker threads
+    HiddenManifest* manifest = nullptr; // Where renames are recorded (none if null)
+};
+
+// Structure for one rename waiting to be done within a directory
+struct PendingRename {
+    string name;    // Current name
+    string newName; // Name after hiding or unhiding
+    int error = 0;  // 0 once renamed, otherwise the errno it failed with
+};
+
+// Function to rename an entry of an open directory without replacing an
+// existing file. The rename is relative to the directory, so the name is
+// not looked up again through the full path. Returns 0 or an errno value.
+// Linux and macOS have an exclusive rename; elsewhere a hard link (which
+// refuses an existing name) followed by removing the old name does the same.
+int renameNoReplace(int dirFd, const string& name, const string& newName) {
+#if defined(__linux__)
+    if (renameat2(dirFd, name.c_str(), dirFd, newName.c_str(), RENAME_NOREPLACE) == 0) return 0;
+    if (errno != EINVAL && errno != ENOSYS) return errno;
+#elif defined(__APPLE__)
+    if (renameatx_np(dirFd, name.c_str(), dirFd, newName.c_str(), RENAME_EXCL) == 0) return 0;
+    if (errno != EINVAL && errno != ENOTSUP) return errno;
+#else
+    if (linkat(dirFd, name.c_str(), dirFd, newName.c_str(), 0) == 0) {
+        if (unlinkat(dirFd, name.c_str(), 0) == 0) return 0;
+        int error = errno;
+        unlinkat(dirFd, newName.c_str(), 0); // Leave only the original name behind
+        return error;
+    }
+    if (errno == EEXIST) return EEXIST;
+    // Directories and some filesystems cannot be hard-linked
+#endif
+    // The filesystem cannot refuse to replace atomically; check first instead
+    struct stat existing;
+    if (fstatat(dirFd, newName.c_str(), &existing, AT_SYMLINK_NOFOLLOW) == 0) return EEXIST;
+    return renameat(dirFd, name.c_str(), dirFd, newName.c_str()) == 0 ? 0 : errno;
+}
+
+// Function to count the outcome of one rename
+void recordRename(const PendingRename& rename, BatchSummary& summary) {
+    if (rename.error == 0) {
+        summary.renamed.fetch_add(1);
+    } else if (rename.error == EEXIST) {
+        summary.conflicts.fetch_add(1);
+    } else {
+        errno = rename.error;
+        reportError(summary, "cannot rename", rename.name);
+    }
+}
+
+// Function to note a successful rename in directory (an absolute path) in the manifest
+void noteInManifest(HiddenManifest* manifest, const string& directory, const PendingRename& rename, Mode mode) {
+    if (manifest == nullptr || rename.error != 0) return;
+    string prefix = directory.back() == '/' ? directory : directory + "/";
+    if (mode == Mode::hide) {
+        manifest->recordHide(prefix + rename.name, prefix + rename.newName);
+    } else {
+        manifest->recordUnhide(prefix + rename.newName);
+    }
+}
+
+#ifdef __linux__
+// IoUring Class: Minimal io_uring instance driven through the raw system
+// calls. Submits a directory's renames as IORING_OP_RENAMEAT operations,
+// keeping at most queueDepth in flight, so the kernel can work on many
+// renames while the thread waits once per batch of completions.
+class IoUring {
+private:
+    int ringFd = -1;                   // The io_uring file descriptor
+    unsigned queueDepth = 0;           // Submission queue entries
+    void* sqRing = MAP_FAILED;         // Mapped submission ring
+    size_t sqRingSize = 0;
+    void* cqRing = MAP_FAILED;         // Mapped completion ring (may be the same mapping)
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED); // Mapped submission entries
+    size_t sqesSize = 0;
+    unsigned* sqHead = nullptr;        // Ring indexes and masks inside the mappings
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    IoUring() = default;
+
+public:
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    ~IoUring() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+        if (ringFd >= 0) close(ringFd);
+    }
+
+    // Function to set up an instance; returns nullptr (with errno set) if the
+    // kernel has no io_uring, forbids it, or cannot rename through it
+    static unique_ptr<IoUring> create(unsigned depth) {
+        unique_ptr<IoUring> ring(new IoUring());
+        io_uring_params params{};
+        ring->ringFd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+        if (ring->ringFd < 0) return nullptr;
+        ring->queueDepth = params.sq_entries;
+
+        ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMap) ring->sqRingSize = ring->cqRingSize = max(ring->sqRingSize, ring->cqRingSize);
+        ring->sqRing = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->ringFd, IORING_OFF_SQ_RING);
+        if (ring->sqRing == MAP_FAILED) return nullptr;
+        ring->cqRing = singleMap ? ring->sqRing
+                                 : mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                        ring->ringFd, IORING_OFF_CQ_RING);
+        if (ring->cqRing == MAP_FAILED) return nullptr;
+        ring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        ring->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, ring->sqesSize, PROT_READ | PROT_WRITE,
+                                                     MAP_SHARED | MAP_POPULATE, ring->ringFd, IORING_OFF_SQES));
+        if (ring->sqes == MAP_FAILED) return nullptr;
+
+        char* sq = static_cast<char*>(ring->sqRing);
+        char* cq = static_cast<char*>(ring->cqRing);
+        ring->sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        ring->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        ring->sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        ring->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        ring->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        ring->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        ring->cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        if (!ring->supportsRename()) {
+            errno = EOPNOTSUPP;
+            return nullptr;
+        }
+        return ring;
+    }
+
+    // Function to perform every rename in the list, filling in each error.
+    // Returns false (with errno set) if the ring itself failed; the renames
+    // it did not perform are then left with ECANCELED for the caller to redo.
+    bool renameAll(int dirFd, vector<PendingRename>& renames) {
+        for (PendingRename& rename : renames) rename.error = ECANCELED;
+        size_t next = 0, completed = 0;
+        unsigned inFlight = 0, unsubmitted = 0;
+        while (completed < renames.size()) {
+            // Queue as many renames as the depth allows
+            unsigned tail = *sqTail;
+            while (next < renames.size() && inFlight + unsubmitted < queueDepth) {
+                unsigned index = tail & *sqMask;
+                io_uring_sqe& sqe = sqes[index];
+                memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = IORING_OP_RENAMEAT;
+                sqe.fd = dirFd;
+                sqe.addr = reinterpret_cast<uintptr_t>(renames[next].name.c_str());
+                sqe.len = static_cast<unsigned>(dirFd);
+                sqe.addr2 = reinterpret_cast<uintptr_t>(renames[next].newName.c_str());
+                sqe.rename_flags = RENAME_NOREPLACE;
+                sqe.user_data = next;
+                sqArray[index] = index;
+                ++tail;
+                ++next;
+                ++unsubmitted;
+            }
+            __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+            // Submit them and wait for at least one completion
+            long submitted = syscall(__NR_io_uring_enter, ringFd, unsubmitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (submitted < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+                // Give renames already in the kernel a moment to report, so they are not redone
+                int error = errno;
+                for (int wait = 0; inFlight > 0 && wait < 1000; ++wait) {
+                    collect(renames, inFlight, completed);
+                    if (inFlight > 0) this_thread::sleep_for(chrono::milliseconds(1));
+                }
+                errno = error;
+                return false;
+            }
+            unsubmitted -= static_cast<unsigned>(submitted);
+            inFlight += static_cast<unsigned>(submitted);
+            collect(renames, inFlight, completed);
+        }
+        return true;
+    }
+
+private:
+    // Function to record the completions the kernel has posted
+    void collect(vector<PendingRename>& renames, unsigned& inFlight, size_t& completed) {
+        unsigned head = *cqHead;
+        unsigned available = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != available; ++head) {
+            const io_uring_cqe& cqe = cqes[head & *cqMask];
+            renames[cqe.user_data].error = cqe.res < 0 ? -cqe.res : 0;
+            --inFlight;
+            ++completed;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    // Function to ask the kernel whether this ring can rename (Linux 5.11+)
+    bool supportsRename() {
+        const unsigned opCount = 256;
+        vector<char> buffer(sizeof(io_uring_probe) + opCount * sizeof(io_uring_probe_op), 0);
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, opCount) < 0) return false;
+        return probe->last_op >= IORING_OP_RENAMEAT && (probe->ops[IORING_OP_RENAMEAT].flags & IO_URING_OP_SUPPORTED);
+    }
+};
+#endif
+
+// Function to perform a directory's renames with the chosen engine. Each
+// thread keeps its own ring; if io_uring cannot be used, or a ring fails
+// partway, the renames are done synchronously instead, with a one-time notice.
+void renameAll(int dirFd, vector<PendingRename>& renames, Engine engine, unsigned queueDepth) {
+#ifdef __linux__
+    static atomic<bool> uringUnavailable(false);
+    if (engine == Engine::uring && !uringUnavailable.load()) {
+        thread_local unique_ptr<IoUring> ring;
+        if (!ring) ring = IoUring::create(queueDepth);
+        if (ring) {
+            bool ringWorked = ring->renameAll(dirFd, renames);
+            if (!ringWorked) {
+                if (!uringUnavailable.exchange(true)) {
+                    cerr << "io_uring failed (" << strerror(errno) << "); using synchronous renames.\n";
+                }
+                ring.reset(); // It may still hold unsubmitted entries; never reuse it
+            }
+            // Filesystems without RENAME_NOREPLACE report EINVAL, and a failed
+            // ring leaves ECANCELED on what it did not do: redo those the slow way
+            for (PendingRename& rename : renames) {
+                if (rename.error == EINVAL || rename.error == ECANCELED) {
+                    rename.error = renameNoReplace(dirFd, rename.name, rename.newName);
+                }
+            }
+            return;
+        }
+        if (!uringUnavailable.exchange(true)) {
+            cerr << "io_uring is not available (" << strerror(errno) << "); using synchronous renames.\n";
+        }
+    }
+#else
+    (void)engine;
+    (void)queueDepth;
+#endif
+    for (PendingRename& rename : renames) {
+        rename.error = renameNoReplace(dirFd, rename.name, rename.newName);
+    }
+}
+
+// BatchRenamer Class: Pool of threads that hide or unhide every file in
+// directory trees. Each directory is one task: a worker reads its names,
+// renames the files and queues the subdirectories for the other workers.
+// A task that throws (the manifest cannot be written) keeps the first error
+// and stops the batch: no more directories are queued or processed.
+class BatchRenamer {
+private:
+    static const size_t maxQueued = 1024; // Beyond this a worker descends itself, bounding open descriptors
+
+    BatchOptions options;        // Mode, engine and thread settings
+    BatchSummary& summary;       // Counters shared by the workers
+    deque<pair<int, string>> queue; // Open directories (and their absolute paths) waiting for a worker
+    size_t busy = 0;             // Directories queued or being processed
+    bool stopping = false;       // Set once all work is done
+    mutex queueMutex;            // Guards queue, busy and stopping
+    condition_variable workReady; // Signalled when a directory is queued or work ends
+    condition_variable allDone;  // Signalled when busy drops to zero
+    vector<thread> workers;      // The worker threads
+    atomic<bool> failed{false};  // Set once a task has thrown
+    string firstError;           // What the first failing task threw
+    mutex errorMutex;            // Guards firstError
+
+public:
+    BatchRenamer(const BatchOptions& batchOptions, BatchSummary& counters) : options(batchOptions), summary(counters) {
+        for (unsigned i = 0; i < max(options.threadCount, 1u); ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    BatchRenamer(const BatchRenamer&) = delete;
+    BatchRenamer& operator=(const BatchRenamer&) = delete;
+
+    ~BatchRenamer() { finish(); }
+
+    // Function to queue an open directory; the renamer closes the descriptor
+    void addDirectory(int dirFd, string path) {
+        if (failed.load()) {
+            close(dirFd);
+            return;
+        }
+        unique_lock<mutex> lock(queueMutex);
+        if (queue.size() >= maxQueued) {
+            ++busy;
+            lock.unlock();
+            runTask(dirFd, path); // Everyone is busy: go depth-first instead of opening more
+            lock.lock();
+            if (--busy == 0) allDone.notify_all();
+            return;
+        }
+        queue.emplace_back(dirFd, move(path));
+        ++busy;
+        workReady.notify_one();
+    }
+
+    // Function to wait until every queued directory is done and stop the workers
+    void finish() {
+        {
+            unique_lock<mutex> lock(queueMutex);
+            allDone.wait(lock, [this] { return busy == 0; });
+            stopping = true;
+        }
+        workReady.notify_all();
+        for (auto& worker : workers) {
+            if (worker.joinable()) worker.join();
+        }
+    }
+
+    // Function to return the error that stopped the batch (empty if none); call after finish
+    const string& error() const { return firstError; }
+
+private:
+    void workerLoop() {
+        unique_lock<mutex> lock(queueMutex);
+        while (true) {
+            workReady.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            auto [dirFd, path] = move(queue.front());
+            queue.pop_front();
+            lock.unlock();
+            runTask(dirFd, path);
+            lock.lock();
+            if (--busy == 0) allDone.notify_all();
+        }
+    }
+
+    // Function to process one directory without letting an exception end
+    // the worker thread (and the process); once one task has failed, the
+    // directories still queued are only closed
+    void runTask(int dirFd, const string& path) {
+        if (failed.load()) {
+            close(dirFd);
+            return;
+        }
+        try {
+            processDirectory(dirFd, path);
+        } catch (const exception& e) {
+            lock_guard<mutex> lock(errorMutex);
+            if (firstError.empty()) firstError = e.what();
+            failed.store(true);
+        }
+    }
+
+    // Function to rename the files in one directory (as one batch) and queue its subdirectories
+    void processDirectory(int dirFd, const string& path) {
+        DIR* dir = fdopendir(dirFd);
+        if (dir == nullptr) {
+            reportError(summary, "cannot read directory", path);
+            close(dirFd);
+            return;
+        }
+        summary.directories.fetch_add(1);
+
+        // Read every name first: renaming while reading could show an entry twice
+        vector<pair<string, bool>> entries; // Name, and whether it is a directory
+        while (dirent* entry = readdir(dir)) {
+            string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            bool isDirectory = entry->d_type == DT_DIR;
+            if (entry->d_type == DT_UNKNOWN) {
+                // Some filesystems do not report types; only then is the entry stat'ed
+                struct stat info;
+                isDirectory = fstatat(dirFd, name.c_str(), &info, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(info.st_mode);
+            }
+            entries.emplace_back(move(name), isDirectory);
+        }
+
+        vector<PendingRename> renames;
+        for (const auto& [name, isDirectory] : entries) {
+            if (!isDirectory) {
+                PendingRename rename{ name, "", 0 };
+                if (targetName(name, options.mode, rename.newName)) {
+                    renames.push_back(move(rename));
+                } else {
+                    summary.unchanged.fetch_add(1);
+                }
+            } else if (options.recursive) {
+                string childPath = (path.back() == '/' ? path : path + "/") + name;
+                int childFd = openat(dirFd, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                if (childFd < 0) {
+                    reportError(summary, "cannot open directory", childPath);
+                } else {
+                    addDirectory(childFd, move(childPath));
+                }
+            }
+        }
+        renameAll(dirFd, renames, options.engine, options.queueDepth);
+        try {
+            for (const PendingRename& rename : renames) {
+                recordRename(rename, summary);
+                noteInManifest(options.manifest, path, rename, options.mode);
+            }
+        } catch (...) {
+            closedir(dir);
+            throw;
+        }
+        closedir(dir); // Also closes dirFd
+    }
+};
+
+// Function to hide or unhide every path given. A directory has its files
+// renamed (and, if recursive, those of every directory below it); any other
+// path is renamed itself. An error that stopped the batch is printed and
+// counted in the summary. Returns the time taken in seconds.
+double renamePaths(const BatchOptions& options, const vector<string>& paths, BatchSummary& summary) {
+    auto start = chrono::steady_clock::now();
+    {
+        BatchRenamer renamer(options, summary);
+        for (const string& path : paths) {
+            int dirFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dirFd >= 0) {
+                renamer.addDirectory(dirFd, fs::absolute(path).lexically_normal().string());
+                continue;
+            }
+            // Not a directory: rename it within its parent
+            fs::path filePath = fs::absolute(path).lexically_normal();
+            string parent = filePath.parent_path().string();
+            int parentFd = open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (parentFd < 0) {
+                reportError(summary, "cannot open directory", parent);
+                continue;
+            }
+            PendingRename rename{ filePath.filename().string(), "", 0 };
+            if (targetName(rename.name, options.mode, rename.newName)) {
+                rename.error = renameNoReplace(parentFd, rename.name, rename.newName);
+                recordRename(rename, summary);
+                noteInManifest(options.manifest, parent, rename, options.mode);
+            } else {
+                summary.unchanged.fetch_add(1);
+            }
+            close(parentFd);
+        }
+        renamer.finish();
+        if (!renamer.error().empty()) {
+            cerr << "Error: batch stopped: " << renamer.error() << "\n";
+            summary.errors.fetch_add(1);
+        }
+    }
+    if (options.manifest != nullptr) options.manifest->commit();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Function to run a batch and print its summary. Returns the exit code.
+int runBatch(const BatchOptions& options, const vector<string>& paths) {
+    BatchSummary summary;
+    double seconds = renamePaths(options, paths, summary);
+    Mode mode = options.mode;
+    size_t entries = summary.renamed + summary.unchanged + summary.conflicts + summary.errors;
+    cout << "Directories scanned: " << summary.directories << "\n"
+         << (mode == Mode::hide ? "Files hidden: " : "Files unhidden: ") << summary.renamed << "\n"
+         << (mode == Mode::hide ? "Already hidden: " : "Already visible: ") << summary.unchanged << "\n"
+         << "Skipped (new name already taken): " << summary.conflicts << "\n"
+         << "Errors: " << summary.errors << "\n"
+         << "Time: " << seconds << " s (" << static_cast<long>(entries / max(seconds, 1e-9)) << " files/s)\n";
+    return summary.errors == 0 ? 0 : 1;
+}
+
+// Function to print the hidden files recorded under a prefix (all if empty)
+void listHidden(const HiddenManifest& manifest, const string& prefix) {
+    auto found = manifest.listUnder(prefix);
+    for (const auto& [original, hidden] : found) {
+        cout << original << " -> " << hidden << "\n";
+    }
+    cout << found.size() << " hidden file(s)\n";
+}
+
+// Function to unhide every file the manifest records under a prefix (all if
+// empty), straight from the recorded paths, without walking the tree.
+// Files that no longer exist are dropped from the manifest.
+int unhideFromManifest(HiddenManifest& manifest, const string& prefix, const BatchOptions& options) {
+    auto start = chrono::steady_clock::now();
+    vector<PendingRename> renames;
+    for (const auto& [original, hidden] : manifest.listUnder(prefix)) {
+        renames.push_back({ hidden, original, 0 });
+    }
+    renameAll(AT_FDCWD, renames, options.engine, options.queueDepth); // Absolute paths, so no directory needed
+
+    BatchSummary summary;
+    size_t missing = 0;
+    for (const PendingRename& rename : renames) {
+        if (rename.error == ENOENT) {
+            cerr << "Warning: " << rename.name << " no longer exists; removed from the manifest.\n";
+            manifest.recordUnhide(rename.newName);
+            ++missing;
+            continue;
+        }
+        recordRename(rename, summary);
+        if (rename.error == 0) manifest.recordUnhide(rename.newName);
+    }
+    manifest.commit();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Files unhidden: " << summary.renamed << "\n"
+         << "Missing (removed from manifest): " << missing << "\n"
+         << "Skipped (new name already taken): " << summary.conflicts << "\n"
+         << "Errors: " << summary.errors << "\n"
+         << "Still hidden: " << manifest.size() << "\n"
+         << "Time: " << seconds << " s\n";
+    return summary.errors == 0 ? 0 : 1;
+}
+
+// Function to compare the rename engines: creates fileCount empty files in a
+// new directory under parent, then hides and unhides them all with each
+// engine, several times over, and prints the best rate for each.
+int benchmarkEngines(size_t fileCount, const string& parent, BatchOptions options) {
+    string directory = parent + "/hidefiles-bench-" + to_string(getpid());
+    if (mkdir(directory.c_str(), 0755) != 0) {
+        cerr << "Error: cannot create " << directory << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+    int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    for (size_t i = 0; i < fileCount && dirFd >= 0; ++i) {
+        int fd = openat(dirFd, ("file" + to_string(i)).c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd >= 0) close(fd);
+    }
+
+    const int rounds = 3;
+    cout << "Renaming " << fileCount << " files in " << directory << " with " << options.threadCount
+         << " thread(s), queue depth " << options.queueDepth << "\n";
+    long errors = 0;
+    for (Engine engine : { Engine::sync, Engine::uring }) {
+        options.engine = engine;
+        double bestHide = 1e30, bestUnhide = 1e30;
+        for (int round = 0; round < rounds; ++round) {
+            BatchSummary hidden, unhidden;
+            options.mode = Mode::hide;
+            bestHide = min(bestHide, renamePaths(options, { directory }, hidden));
+            options.mode = Mode::unhide;
+            bestUnhide = min(bestUnhide, renamePaths(options, { directory }, unhidden));
+            if (hidden.renamed != fileCount || unhidden.renamed != fileCount) ++errors;
+        }
+        cout << (engine == Engine::sync ? "sync:     " : "io_uring: ") << static_cast<long>(fileCount / bestHide)
+             << " hides/s, " << static_cast<long>(fileCount / bestUnhide) << " unhides/s\n";
+    }
+
+    // Remove the files (some may be hidden if a round failed) and the directory
+    for (size_t i = 0; i < fileCount && dirFd >= 0; ++i) {
+        string name = "file" + to_string(i);
+        if (unlinkat(dirFd, name.c_str(), 0) != 0) unlinkat(dirFd, ("." + name).c_str(), 0);
+    }
+    if (dirFd >= 0) close(dirFd);
+    rmdir(directory.c_str());
+    if (errors != 0) cerr << "Error: " << errors << " round(s) did not rename every file.\n";
+    return errors == 0 ? 0 : 1;
+}
+
+// ContentCipher Class: Keyed stream cipher (ChaCha20 with a 64-bit block
+// counter and 64-bit nonce) used to make file contents unreadable at rest.
+// Contents are XORed with the keystream, so obfuscating and restoring are
+// the same operation and run at the same speed. Eight 64-byte blocks are
+// generated at once, each in its own lane of GCC/Clang vector types, which
+// the compiler turns into SSE/AVX/NEON instructions.
+class ContentCipher {
+public:
+    static const size_t keySize = 32;
+    static const size_t blockSize = 64;
+    static const size_t blocksPerBatch = 8;
+    static const size_t batchSize = blockSize * blocksPerBatch;
+
+private:
+    typedef uint32_t Lanes __attribute__((vector_size(4 * blocksPerBatch))); // One state word of each block
+    uint32_t state[16]; // Constants, key and nonce; words 12-13 (the block counter) are set per batch
+
+    static void rotate(Lanes& x, int bits) { x = (x << bits) | (x >> (32 - bits)); }
+
+    static void quarterRound(Lanes& a, Lanes& b, Lanes& c, Lanes& d) {
+        a += b; d ^= a; rotate(d, 16);
+        c += d; b ^= c; rotate(b, 12);
+        a += b; d ^= a; rotate(d, 8);
+        c += d; b ^= c; rotate(b, 7);
+    }
+
+    static uint32_t littleEndian(uint32_t word) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return __builtin_bswap32(word);
+#else
+        return word;
+#endif
+    }
+
+    static uint32_t load32(const unsigned char* bytes) {
+        return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+    }
+
+public:
+    ContentCipher(const unsigned char (&key)[keySize], uint64_t nonce) {
+        const char* constant = "expand 32-byte k";
+        for (int i = 0; i < 4; ++i) state[i] = load32(reinterpret_cast<const unsigned char*>(constant) + 4 * i);
+        for (int i = 0; i < 8; ++i) state[4 + i] = load32(key + 4 * i);
+        state[12] = state[13] = 0;
+        state[14] = static_cast<uint32_t>(nonce);
+        state[15] = static_cast<uint32_t>(nonce >> 32);
+    }
+
+    // Function to generate the keystream of blocks firstBlock .. firstBlock+7
+    void keystream(uint64_t firstBlock, unsigned char (&out)[batchSize]) const {
+        Lanes x[16], input[16];
+        for (int i = 0; i < 16; ++i) input[i] = Lanes{} + state[i];
+        for (size_t lane = 0; lane < blocksPerBatch; ++lane) {
+            uint64_t block = firstBlock + lane;
+            input[12][lane] = static_cast<uint32_t>(block);
+            input[13][lane] = static_cast<uint32_t>(block >> 32);
+        }
+        for (int i = 0; i < 16; ++i) x[i] = input[i];
+        for (int round = 0; round < 10; ++round) {
+            quarterRound(x[0], x[4], x[8], x[12]);
+            quarterRound(x[1], x[5], x[9], x[13]);
+            quarterRound(x[2], x[6], x[10], x[14]);
+            quarterRound(x[3], x[7], x[11], x[15]);
+            quarterRound(x[0], x[5], x[10], x[15]);
+            quarterRound(x[1], x[6], x[11], x[12]);
+            quarterRound(x[2], x[7], x[8], x[13]);
+            quarterRound(x[3], x[4], x[9], x[14]);
+        }
+        // Lane j of word i is word i of block j; blocks are stored little-endian one after another
+        uint32_t words[16][blocksPerBatch];
+        for (int i = 0; i < 16; ++i) {
+            Lanes word = x[i] + input[i];
+            memcpy(words[i], &word, sizeof(word));
+        }
+        for (size_t lane = 0; lane < blocksPerBatch; ++lane) {
+            uint32_t block[16];
+            for (int i = 0; i < 16; ++i) block[i] = littleEndian(words[i][lane]);
+            memcpy(out + lane * blockSize, block, blockSize);
+        }
+    }
+
+    // Function to XOR length bytes of input with the keystream into output
+    // (which may be the same buffer); input must begin at byte
+    // firstBlock * blockSize of the stream
+    void apply(const unsigned char* input, unsigned char* output, size_t length, uint64_t firstBlock) const {
+        alignas(32) unsigned char stream[batchSize];
+        while (length > 0) {
+            keystream(firstBlock, stream);
+            if (length >= batchSize) {
+                for (size_t i = 0; i < batchSize; i += sizeof(Lanes)) {
+                    Lanes bytes, key;
+                    memcpy(&bytes, input + i, sizeof(Lanes)); // Unaligned-safe vector load
+                    memcpy(&key, stream + i, sizeof(Lanes));
+                    bytes ^= key;
+                    memcpy(output + i, &bytes, sizeof(Lanes));
+                }
+                input += batchSize;
+                output += batchSize;
+                length -= batchSize;
+                firstBlock += blocksPerBatch;
+            } else {
+                for (size_t i = 0; i < length; ++i) output[i] = input[i] ^ stream[i];
+                length = 0;
+            }
+        }
+    }
+
+    void apply(unsigned char* data, size_t length, uint64_t firstBlock) const {
+        apply(data, data, length, firstBlock);
+    }
+};
+
+// Enum for the direction of a content transform
+enum class Transform { obfuscate, restore };
+
+// Structure appended to an obfuscated file: the nonce its keystream was
+// made with and a check value to refuse the wrong key
+struct ObfuscationTrailer {
+    char magic[8];      // "HFOBF1" and two zero bytes
+    uint64_t nonce;     // Random per file, so files never share a keystream
+    uint64_t keyCheck;  // Keystream of the last block, which data never reaches
+    uint64_t length;    // Original size of the contents
+    uint32_t state;     // Always trailerComplete
+    uint32_t reserved;
+};
+static const char trailerMagic[8] = { 'H', 'F', 'O', 'B', 'F', '1', 0, 0 };
+static const uint32_t trailerComplete = 0;
+
+// Function to find the content key: $HIDEFILES_KEY, else ~/.hidefiles-key
+string defaultKeyPath() {
+    if (const char* configured = getenv("HIDEFILES_KEY")) return configured;
+    if (const char* home = getenv("HOME")) return string(home) + "/.hidefiles-key";
+    return ".hidefiles-key";
+}
+
+// Function to fill a buffer from the system's random source
+void readRandom(void* buffer, size_t size) {
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || read(fd, buffer, size) != static_cast<ssize_t>(size)) {
+        if (fd >= 0) close(fd);
+        throw runtime_error("Cannot read /dev/urandom: " + string(strerror(errno)));
+    }
+    close(fd);
+}
+
+// Function to read the 32-byte content key, creating a random one (readable
+// only by its owner) if create is set and there is none yet
+void loadKey(const string& path, bool create, unsigned char (&key)[ContentCipher::keySize]) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0 && errno == ENOENT && create) {
+        readRandom(key, sizeof(key));
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd < 0) throw runtime_error("Cannot create key " + path + ": " + strerror(errno));
+        bool written = write(fd, key, sizeof(key)) == static_cast<ssize_t>(sizeof(key)) && fsync(fd) == 0;
+        close(fd);
+        if (!written) {
+            unlink(path.c_str());
+            throw runtime_error("Failed to write key " + path);
+        }
+        cout << "Created a new content key in " << path << " (keep it: restoring needs it).\n";
+        return;
+    }
+    if (fd < 0) throw runtime_error("Cannot open key " + path + ": " + strerror(errno));
+    ssize_t got = read(fd, key, sizeof(key));
+    close(fd);
+    if (got != static_cast<ssize_t>(sizeof(key))) {
+        throw runtime_error("Key " + path + " must be " + to_string(sizeof(key)) + " bytes");
+    }
+}
+
+// Function to compute a trailer's key check value
+uint64_t keyCheck(const ContentCipher& cipher) {
+    unsigned char stream[ContentCipher::batchSize];
+    cipher.keystream(UINT64_MAX - ContentCipher::blocksPerBatch + 1, stream);
+    uint64_t check;
+    memcpy(&check, stream + ContentCipher::batchSize - sizeof(check), sizeof(check));
+    return check;
+}
+
+// Function to XOR the first length bytes of an open file with the keystream
+// into another open file (already at least length bytes long). Both are
+// mapped a chunk at a time; threads take chunks in turn, so a large file is
+// spread across all of them.
+void transformContents(int inFd, int outFd, uint64_t length, const ContentCipher& cipher, unsigned threadCount) {
+    const uint64_t chunkSize = 64 << 20; // A multiple of the page and block sizes
+    uint64_t chunkCount = (length + chunkSize - 1) / chunkSize;
+    atomic<uint64_t> nextChunk(0);
+    string firstError;
+    mutex errorMutex;
+
+    auto worker = [&] {
+        for (uint64_t chunk; (chunk = nextChunk.fetch_add(1)) < chunkCount;) {
+            uint64_t offset = chunk * chunkSize;
+            size_t size = static_cast<size_t>(min(chunkSize, length - offset));
+            int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+            flags |= MAP_POPULATE; // Fault the chunk in up front rather than page by page
+#endif
+            void* input = mmap(nullptr, size, PROT_READ, flags, inFd, static_cast<off_t>(offset));
+            void* output = input == MAP_FAILED ? MAP_FAILED
+                                               : mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, outFd,
+                                                      static_cast<off_t>(offset));
+            if (output == MAP_FAILED) {
+                int error = errno;
+                if (input != MAP_FAILED) munmap(input, size);
+                lock_guard<mutex> lock(errorMutex);
+                if (firstError.empty()) firstError = "cannot map file: " + string(strerror(error));
+                nextChunk.store(chunkCount); // Stop the other threads too
+                return;
+            }
+            posix_madvise(input, size, POSIX_MADV_SEQUENTIAL);
+            cipher.apply(static_cast<const unsigned char*>(input), static_cast<unsigned char*>(output), size,
+                         offset / ContentCipher::blockSize);
+            munmap(input, size);
+            munmap(output, size); // Dirty pages are written back by the kernel; the caller syncs
+        }
+    };
+
+    unsigned helpers = static_cast<unsigned>(min<uint64_t>(max(threadCount, 1u), chunkCount));
+    vector<thread> threads;
+    for (unsigned i = 1; i < helpers; ++i) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+    if (!firstError.empty()) throw runtime_error(firstError);
+}
+
+// Function to obfuscate or restore one file's contents. The result is
+// written to a temporary file beside it, synced, and renamed over the
+// original, so a crash at any point leaves either the untouched original or
+// the finished result (plus, at worst, a stray temporary file) and never a
+// mix of the two. The copy keeps the file's permissions and, where allowed,
+// its owner; files with other hard links are refused, since replacing the
+// file would detach them. Returns the bytes transformed.
+uint64_t transformFile(const string& path, Transform transform, const unsigned char (&key)[ContentCipher::keySize],
+                       unsigned threadCount) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw runtime_error("cannot open " + path + ": " + strerror(errno));
+    string target, tmpPath;
+    int tmpFd = -1;
+    try {
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) throw runtime_error(path + " is not a regular file");
+        if (info.st_nlink > 1) throw runtime_error(path + " has other hard links, which replacing it would break");
+        uint64_t size = static_cast<uint64_t>(info.st_size);
+
+        ObfuscationTrailer trailer{};
+        bool hasTrailer = size >= sizeof(trailer) &&
+                          pread(fd, &trailer, sizeof(trailer), static_cast<off_t>(size - sizeof(trailer))) ==
+                              static_cast<ssize_t>(sizeof(trailer)) &&
+                          memcmp(trailer.magic, trailerMagic, sizeof(trailerMagic)) == 0 &&
+                          trailer.length == size - sizeof(trailer);
+        if (hasTrailer && trailer.state != trailerComplete) {
+            throw runtime_error(path + " has an unknown trailer state and cannot be transformed safely");
+        }
+        uint64_t length; // Bytes to transform
+        uint64_t outputSize;
+        if (transform == Transform::obfuscate) {
+            if (hasTrailer) throw runtime_error(path + " is already obfuscated");
+            memcpy(trailer.magic, trailerMagic, sizeof(trailerMagic));
+            readRandom(&trailer.nonce, sizeof(trailer.nonce));
+            trailer.keyCheck = keyCheck(ContentCipher(key, trailer.nonce));
+            trailer.length = size;
+            trailer.state = trailerComplete;
+            length = size;
+            outputSize = size + sizeof(trailer);
+        } else {
+            if (!hasTrailer) throw runtime_error(path + " is not obfuscated");
+            if (keyCheck(ContentCipher(key, trailer.nonce)) != trailer.keyCheck) {
+                throw runtime_error(path + " was obfuscated with a different key");
+            }
+            length = trailer.length;
+            outputSize = trailer.length;
+        }
+        ContentCipher cipher(key, trailer.nonce);
+
+        // Replace the file a symlink points to, not the symlink itself
+        target = fs::canonical(path).string();
+        tmpPath = target + ".XXXXXX";
+        tmpFd = mkstemp(&tmpPath[0]);
+        if (tmpFd < 0) throw runtime_error("cannot create a temporary file beside " + path + ": " + strerror(errno));
+        fcntl(tmpFd, F_SETFD, FD_CLOEXEC);
+        // Keep the owner; an unprivileged run must not take over someone else's file
+        if (fchown(tmpFd, info.st_uid, info.st_gid) != 0 && info.st_uid != geteuid()) {
+            throw runtime_error(path + " belongs to another user and cannot be replaced: " + strerror(errno));
+        }
+        if (fchmod(tmpFd, info.st_mode & 07777) != 0 || ftruncate(tmpFd, static_cast<off_t>(outputSize)) != 0) {
+            throw runtime_error("cannot prepare a temporary copy of " + path + ": " + strerror(errno));
+        }
+        transformContents(fd, tmpFd, length, cipher, threadCount);
+        if (transform == Transform::obfuscate &&
+            pwrite(tmpFd, &trailer, sizeof(trailer), static_cast<off_t>(size)) != static_cast<ssize_t>(sizeof(trailer))) {
+            throw runtime_error("cannot write trailer of " + path + ": " + strerror(errno));
+        }
+        if (fsync(tmpFd) != 0) throw runtime_error("cannot sync the copy of " + path + ": " + strerror(errno));
+        if (rename(tmpPath.c_str(), target.c_str()) != 0) {
+            throw runtime_error("cannot replace " + path + ": " + strerror(errno));
+        }
+        close(tmpFd);
+        close(fd);
+        return length;
+    } catch (...) {
+        if (tmpFd >= 0) {
+            close(tmpFd);
+            unlink(tmpPath.c_str());
+        }
+        close(fd);
+        throw;
+    }
+}
+
+// Function to obfuscate or restore every file given and print the throughput. Returns the exit code.
+int runTransform(Transform transform, const vector<string>& paths, const string& keyPath, unsigned threadCount) {
+    unsigned char key[ContentCipher::keySize];
+    loadKey(keyPath, transform == Transform::obfuscate, key);
+    int errors = 0;
+    uint64_t bytes = 0;
+    auto start = chrono::steady_clock::now();
+    for (const string& path : paths) {
+        try {
+            bytes += transformFile(path, transform, key, threadCount);
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+            ++errors;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << (transform == Transform::obfuscate ? "Files obfuscated: " : "Files restored: ")
+         << paths.size() - errors << "\n"
+         << "Errors: " << errors << "\n"
+         << "Time: " << seconds << " s (" << bytes / max(seconds, 1e-9) / 1e6 << " MB/s)\n";
+    memset(key, 0, sizeof(key));
+    return errors == 0 ? 0 : 1;
+}
+
+// Function to measure the cipher on a buffer in memory, next to a plain
+// copy of the same buffer as a rough memory-bandwidth reference
+int benchmarkCipher(size_t megabytes, unsigned threadCount) {
+    size_t size = megabytes << 20;
+    vector<unsigned char> buffer(size, 1), copy(size);
+    unsigned char key[ContentCipher::keySize] = {};
+    ContentCipher cipher(key, 0);
+    size_t share = (size / max(threadCount, 1u) + ContentCipher::batchSize - 1) / ContentCipher::batchSize *
+                   ContentCipher::batchSize;
+
+    double bestCipher = 1e30, bestCopy = 1e30;
+    for (int round = 0; round < 3; ++round) {
+        auto start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for (size_t offset = 0; offset < size; offset += share) {
+            threads.emplace_back([&, offset] {
+                cipher.apply(buffer.data() + offset, min(share, size - offset), offset / ContentCipher::blockSize);
+            });
+        }
+        for (auto& t : threads) t.join();
+        bestCipher = min(bestCipher, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+        start = chrono::steady_clock::now();
+        memcpy(copy.data(), buffer.data(), size);
+        bestCopy = min(bestCopy, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    cout << "Cipher (" << threadCount << " thread(s)): " << size / bestCipher / 1e9 << " GB/s\n"
+         << "memcpy (1 thread):   " << size / bestCopy / 1e9 << " GB/s\n";
+    return copy[size - 1] == buffer[size - 1] ? 0 : 1; // Keeps the copy from being optimized away
+}
+#endif
+
+#ifndef _WIN32
+// Function to check that the manifest survives compaction when its entries
+// encode to more than the 1 MB pending buffer: hides entryCount long paths,
+// unhides and rehides them all so most of the log is stale, commits (which
+// compacts) and reloads it from disk. Returns 0 if every entry came back.
+int checkManifest(size_t entryCount, const string& parent) {
+    string manifestPath = parent + "/hidefiles-manifest-check-" + to_string(getpid());
+    unlink(manifestPath.c_str());
+    auto original = [](size_t i) { return "/check/" + string(240, 'd') + "/file" + to_string(i); };
+    auto hidden = [](size_t i) { return "/check/" + string(240, 'd') + "/.file" + to_string(i); };
+    size_t encodedBytes = 0;
+    {
+        HiddenManifest manifest(manifestPath);
+        for (size_t i = 0; i < entryCount; ++i) manifest.recordHide(original(i), hidden(i));
+        manifest.commit();
+        for (size_t i = 0; i < entryCount; ++i) {
+            manifest.recordUnhide(original(i));
+            manifest.recordHide(original(i), hidden(i));
+        }
+        manifest.commit();
+        struct stat info;
+        if (stat(manifestPath.c_str(), &info) == 0) encodedBytes = static_cast<size_t>(info.st_size);
+    }
+    HiddenManifest reloaded(manifestPath);
+    auto found = reloaded.listUnder("");
+    bool intact = found.size() == entryCount;
+    for (size_t i = 0; i < entryCount && intact; ++i) {
+        auto entry = reloaded.listUnder(original(i));
+        intact = entry.size() == 1 && entry[0].second == hidden(i);
+    }
+    unlink(manifestPath.c_str());
+    cout << "Manifest check: " << found.size() << " of " << entryCount << " entries (" << encodedBytes
+         << " bytes compacted) " << (intact ? "survived" : "were NOT all kept") << "\n";
+    return intact ? 0 : 1;
+}
+#endif
+
+int main(int argc, char* argv[]) {
+    // Batch mode: hidefiles --hide|--unhide [options] path...
+    //            hidefiles --list|--unhide-prefix [options] [prefix]
+    //            hidefiles --unhide-all [options]
+    //            hidefiles --bench-engines [options] [files] [directory]
+    //            hidefiles --obfuscate|--restore [options] file...
+    //            hidefiles --bench-cipher [options] [megabytes]
+    //            hidefiles --check-manifest [entries] [directory]
+    // Options: --recursive, --threads N, --engine sync|uring, --queue-depth N, --manifest path, --key path
+    const string command = argc > 1 ? argv[1] : "";
+    if (command == "--hide" || command == "--unhide" || command == "--list" || command == "--unhide-all" ||
+        command == "--unhide-prefix" || command == "--bench-engines" || command == "--obfuscate" ||
+        command == "--restore" || command == "--bench-cipher" || command == "--check-manifest") {
+#ifdef _WIN32
+        cerr << "Error: Batch mode is only available on Linux/macOS.\n";
+        return 1;
+#else
+        try {
+            BatchOptions options;
+            options.mode = command == "--unhide" ? Mode::unhide : Mode::hide;
+            string manifestPath = HiddenManifest::defaultPath();
+            string keyPath = defaultKeyPath();
+            vector<string> paths;
+            for (int i = 2; i < argc; ++i) {
+                string argument = argv[i];
+                if (argument == "-r" || argument == "--recursive") {
+                    options.recursive = true;
+                } else if ((argument == "-j" || argument == "--threads") && i + 1 < argc) {
+                    options.threadCount = static_cast<unsigned>(stoul(argv[++i]));
+                } else if (argument == "--engine" && i + 1 < argc) {
+                    string engine = argv[++i];
+                    if (engine != "sync" && engine != "uring") {
+                        cerr << "Error: Unknown engine " << engine << " (use sync or uring).\n";
+                        return 1;
+                    }
+                    options.engine = engine == "uring" ? Engine::uring : Engine::sync;
+                } else if (argument == "--queue-depth" && i + 1 < argc) {
+                    options.queueDepth = max(static_cast<unsigned>(stoul(argv[++i])), 1u);
+                } else if (argument == "--manifest" && i + 1 < argc) {
+                    manifestPath = argv[++i];
+                } else if (argument == "--key" && i + 1 < argc) {
+                    keyPath = argv[++i];
+                } else {
+                    paths.push_back(argument);
+                }
+            }
+            if (command == "--bench-engines") {
+                size_t fileCount = paths.size() > 0 ? stoul(paths[0]) : 100000;
+                return benchmarkEngines(fileCount, paths.size() > 1 ? paths[1] : ".", options);
+            }
+            if (command == "--check-manifest") {
+                return checkManifest(paths.size() > 0 ? stoul(paths[0]) : 2500, paths.size() > 1 ? paths[1] : ".");
+            }
+            if (command == "--bench-cipher") {
+                return benchmarkCipher(paths.empty() ? 1024 : stoul(paths[0]), options.threadCount);
+            }
+            if (command == "--obfuscate" || command == "--restore") {
+                if (paths.empty()) {
+                    cerr << "Usage: " << argv[0] << " --obfuscate|--restore [--threads N] [--key path] file...\n";
+                    return 1;
+                }
+                return runTransform(command == "--obfuscate" ? Transform::obfuscate : Transform::restore, paths,
+                                    keyPath, options.threadCount);
+            }
+            HiddenManifest manifest(manifestPath);
+            options.manifest = &manifest;
+            string prefix = paths.empty() ? "" : fs::absolute(paths[0]).lexically_normal().string();
+            if (command == "--list") {
+                listHidden(manifest, prefix);
+                return 0;
+            }
+            if (command == "--unhide-all" || command == "--unhide-prefix") {
+                if (command == "--unhide-prefix" && prefix.empty()) {
+                    cerr << "Usage: " << argv[0] << " --unhide-prefix [options] directory\n";
+                    return 1;
+                }
+                return unhideFromManifest(manifest, command == "--unhide-all" ? "" : prefix, options);
+            }
+            if (paths.empty()) {
+                cerr << "Usage: " << argv[0] << " --hide|--unhide [--recursive] [--threads N] "
+                     << "[--engine sync|uring] [--queue-depth N] path...\n";
+                return 1;
+            }
+            return runBatch(options, paths);
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+#endif
+    }
+
     try {
         // Display the menu to the user
         cout << "File Hide/Unhide Utility\n";
         cout << "1. Hide a file\n";   // Option to hide a file
         cout << "2. Unhide a file\n"; // Option to unhide a file
-        cout << "Choose an option (1 or 2): ";
+        cout << "3. Obfuscate a file's contents\n"; // Option to make the contents unreadable
+        cout << "4. Restore a file's contents\n";   // Option to undo option 3
+        cout << "Choose an option (1-4): ";
         int choice;
         cin >> choice; // Take user input for the choice
 
@@ -73,10 +1463,32 @@ int main() {
         cin >> filePath; // Take user input for the file path
 
         // Perform the appropriate action based on the user's choice
-        if (choice == 1) {
-            hideFile(filePath); // Call hideFile to hide the specified file
-        } else if (choice == 2) {
-            unhideFile(filePath); // Call unhideFile to unhide the specified file
+        if (choice == 1 || choice == 2) {
+            // Keep track of what is hidden so it can be listed or unhidden later
+#ifndef _WIN32
+            unique_ptr<HiddenManifest> manifestFile;
+            try {
+                manifestFile = make_unique<HiddenManifest>(HiddenManifest::defaultPath());
+            } catch (const exception& e) {
+                cerr << "Warning: " << e.what() << " (continuing without a manifest)\n";
+            }
+            HiddenManifest* manifest = manifestFile.get();
+#else
+            HiddenManifest* manifest = nullptr; // Windows hides files in place, so there is nothing to record
+#endif
+            if (choice == 1) {
+                hideFile(filePath, manifest); // Call hideFile to hide the specified file
+            } else {
+                unhideFile(filePath, manifest); // Call unhideFile to unhide the specified file
+            }
+        } else if (choice == 3 || choice == 4) {
+#ifdef _WIN32
+            cerr << "Error: Obfuscating contents is only available on Linux/macOS.\n";
+#else
+            // The key is read from (or, when obfuscating, created at) $HIDEFILES_KEY or ~/.hidefiles-key
+            runTransform(choice == 3 ? Transform::obfuscate : Transform::restore, { filePath }, defaultKeyPath(),
+                         max(thread::hardware_concurrency(), 1u));
+#endif
         } else {
             cerr << "Invalid choice.\n"; // Handle invalid user input
         }